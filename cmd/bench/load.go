@@ -0,0 +1,180 @@
+package main
+
+import (
+	"fmt"
+	"io"
+	"net"
+	"net/http"
+	"os"
+	"sort"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// maxSamplesPerWorker caps per-worker latency recording so a long run cannot
+// grow memory without bound; at the cap, roughly the first N operations are
+// recorded, which is ample for stable percentiles.
+const maxSamplesPerWorker = 1 << 20
+
+// worker-local load state; merged into the final report after the run.
+type loadWorker struct {
+	ops     atomic.Int64
+	errs    atomic.Int64
+	bytes   atomic.Int64
+	samples []time.Duration
+}
+
+func (w *loadWorker) record(d time.Duration) {
+	w.ops.Add(1)
+	if len(w.samples) < maxSamplesPerWorker {
+		w.samples = append(w.samples, d)
+	}
+}
+
+// runLoad drives the gateway at addr with conns concurrent workers for the
+// given duration and prints a throughput/latency report. rate > 0 switches
+// from closed-loop to open-loop: each worker paces itself so the aggregate
+// offered load is rate req/s regardless of how fast responses return.
+func runLoad(mode, addr string, conns int, duration time.Duration, rate float64, payload int, path string) {
+	workers := make([]*loadWorker, conns)
+	for i := range workers {
+		workers[i] = &loadWorker{samples: make([]time.Duration, 0, 4096)}
+	}
+
+	var perWorkerInterval time.Duration
+	if rate > 0 {
+		perWorkerInterval = time.Duration(float64(conns) / rate * float64(time.Second))
+	}
+
+	stop := time.Now().Add(duration)
+	var wg sync.WaitGroup
+	fmt.Printf("mode=%s addr=%s connections=%d duration=%v loop=%s\n",
+		mode, addr, conns, duration, loopName(rate))
+
+	for i := 0; i < conns; i++ {
+		w := workers[i]
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			switch mode {
+			case "tcp":
+				tcpWorker(w, addr, stop, perWorkerInterval, payload)
+			case "http":
+				httpWorker(w, addr, stop, perWorkerInterval, path)
+			}
+		}()
+	}
+	wg.Wait()
+
+	report(workers, duration)
+}
+
+func loopName(rate float64) string {
+	if rate > 0 {
+		return fmt.Sprintf("open(%.0f req/s)", rate)
+	}
+	return "closed"
+}
+
+// tcpWorker holds one long-lived connection through the gateway and measures
+// echo round trips: write payload bytes, read the same count back. The
+// backend behind the gateway must echo for this mode to work.
+func tcpWorker(w *loadWorker, addr string, stop time.Time, interval time.Duration, payload int) {
+	conn, err := net.DialTimeout("tcp", addr, 5*time.Second)
+	if err != nil {
+		w.errs.Add(1)
+		fmt.Fprintf(os.Stderr, "dial %s: %v\n", addr, err)
+		return
+	}
+	defer conn.Close()
+
+	out := make([]byte, payload)
+	for i := range out {
+		out[i] = byte(i)
+	}
+	in := make([]byte, payload)
+
+	for time.Now().Before(stop) {
+		start := time.Now()
+		conn.SetDeadline(time.Now().Add(10 * time.Second))
+		if _, err := conn.Write(out); err != nil {
+			w.errs.Add(1)
+			return
+		}
+		if _, err := io.ReadFull(conn, in); err != nil {
+			w.errs.Add(1)
+			return
+		}
+		w.record(time.Since(start))
+		w.bytes.Add(int64(2 * payload))
+		pace(start, interval)
+	}
+}
+
+func httpWorker(w *loadWorker, addr string, stop time.Time, interval time.Duration, path string) {
+	// One transport per worker with a single cached connection models one
+	// closed-loop client; errors fall through to reconnects inside the
+	// transport rather than aborting the worker.
+	client := &http.Client{
+		Transport: &http.Transport{MaxIdleConnsPerHost: 1},
+		Timeout:   10 * time.Second,
+	}
+	url := "http://" + addr + path
+
+	for time.Now().Before(stop) {
+		start := time.Now()
+		resp, err := client.Get(url)
+		if err != nil {
+			w.errs.Add(1)
+			continue
+		}
+		n, _ := io.Copy(io.Discard, resp.Body)
+		resp.Body.Close()
+		w.record(time.Since(start))
+		w.bytes.Add(n)
+		pace(start, interval)
+	}
+}
+
+// pace sleeps out the remainder of the open-loop interval; a no-op in
+// closed-loop mode.
+func pace(start time.Time, interval time.Duration) {
+	if interval <= 0 {
+		return
+	}
+	if sleep := interval - time.Since(start); sleep > 0 {
+		time.Sleep(sleep)
+	}
+}
+
+func report(workers []*loadWorker, duration time.Duration) {
+	var ops, errs, bytes int64
+	var all []time.Duration
+	for _, w := range workers {
+		ops += w.ops.Load()
+		errs += w.errs.Load()
+		bytes += w.bytes.Load()
+		all = append(all, w.samples...)
+	}
+	if ops == 0 {
+		fmt.Println("no completed operations (all workers failed?)")
+		return
+	}
+	sort.Slice(all, func(i, j int) bool { return all[i] < all[j] })
+
+	secs := duration.Seconds()
+	fmt.Printf("\nops        %12d   (%.0f ops/s)\n", ops, float64(ops)/secs)
+	fmt.Printf("errors     %12d\n", errs)
+	fmt.Printf("throughput %12.2f MB/s\n", float64(bytes)/secs/(1<<20))
+	fmt.Printf("latency    p50=%v p90=%v p99=%v p999=%v max=%v\n",
+		pct(all, 0.50), pct(all, 0.90), pct(all, 0.99), pct(all, 0.999), all[len(all)-1])
+}
+
+func pct(sorted []time.Duration, q float64) time.Duration {
+	if len(sorted) == 0 {
+		return 0
+	}
+	idx := int(q * float64(len(sorted)-1))
+	return sorted[idx].Round(time.Microsecond)
+}
@@ -0,0 +1,139 @@
+package main
+
+import (
+	"fmt"
+	"net"
+	"net/http"
+	"testing"
+	"time"
+
+	"github.com/SkynetNext/unified-access-gateway/internal/config"
+	"github.com/SkynetNext/unified-access-gateway/internal/core"
+	"github.com/SkynetNext/unified-access-gateway/internal/middleware"
+	"github.com/SkynetNext/unified-access-gateway/internal/security"
+)
+
+// runMicro executes the in-process hot-path benchmarks via
+// testing.Benchmark, so the harness reports the same ns/op and allocs/op a
+// go-test benchmark would without the repository needing test targets.
+func runMicro() {
+	benches := []struct {
+		name string
+		fn   func(b *testing.B)
+	}{
+		{"SniffConn.Sniff/http", benchSniff([]byte("GET /api/v1/session HTTP/1.1\r\nHost: gw\r\n\r\n"))},
+		{"SniffConn.Sniff/tls", benchSniff([]byte{0x16, 0x03, 0x01, 0x00, 0x2e, 0x01, 0x00})},
+		{"SniffConn.Sniff/binary", benchSniff([]byte{0xde, 0xad, 0xbe, 0xef, 0x00, 0x01})},
+		{"Security.CheckConnection", benchCheckConnection},
+		{"Security.ApplyWAF", benchApplyWAF},
+		{"Logger.Log", benchLoggerLog},
+	}
+	for _, bm := range benches {
+		r := testing.Benchmark(bm.fn)
+		fmt.Printf("%-28s %10d ops %12.1f ns/op %8d B/op %6d allocs/op\n",
+			bm.name, r.N, float64(r.T.Nanoseconds())/float64(r.N),
+			r.AllocedBytesPerOp(), r.AllocsPerOp())
+	}
+}
+
+// fakeConn replays a canned byte sequence through the net.Conn interface so
+// the sniffer benchmark exercises the real peek/dispatch path without
+// sockets in the loop.
+type fakeConn struct {
+	data []byte
+	off  int
+}
+
+var fakeAddr = &net.TCPAddr{IP: net.IPv4(10, 0, 0, 1), Port: 40000}
+
+func (c *fakeConn) Read(p []byte) (int, error) {
+	n := copy(p, c.data[c.off:])
+	c.off += n
+	return n, nil
+}
+func (c *fakeConn) Write(p []byte) (int, error)      { return len(p), nil }
+func (c *fakeConn) Close() error                     { return nil }
+func (c *fakeConn) LocalAddr() net.Addr              { return fakeAddr }
+func (c *fakeConn) RemoteAddr() net.Addr             { return fakeAddr }
+func (c *fakeConn) SetDeadline(time.Time) error      { return nil }
+func (c *fakeConn) SetReadDeadline(time.Time) error  { return nil }
+func (c *fakeConn) SetWriteDeadline(time.Time) error { return nil }
+
+func benchSniff(head []byte) func(b *testing.B) {
+	return func(b *testing.B) {
+		fc := &fakeConn{data: head}
+		b.ReportAllocs()
+		b.ResetTimer()
+		for i := 0; i < b.N; i++ {
+			fc.off = 0
+			sc := core.NewSniffConn(fc)
+			sc.Sniff()
+			sc.Release()
+		}
+	}
+}
+
+// benchSecurityManager builds a manager with every check enabled and enough
+// state (blocked IPs, patterns) that the lookups do real work. The rate
+// limit is set high enough to never trip, so the benchmark measures the
+// check itself rather than the deny path.
+func benchSecurityManager() *security.Manager {
+	cfg := &config.Config{}
+	cfg.Security.RateLimit = config.RateLimitConfig{Enabled: true, RequestsPerSecond: 1e9, Burst: 1 << 20}
+	cfg.Security.WAF = config.WAFConfig{
+		Enabled:         true,
+		BlockedIPs:      []string{"192.0.2.1", "192.0.2.2", "198.51.100.7", "203.0.113.9"},
+		BlockedPatterns: []string{"../", "select ", "<script", "union all"},
+	}
+	return security.NewManager(cfg, nil)
+}
+
+func benchCheckConnection(b *testing.B) {
+	m := benchSecurityManager()
+	addr := &net.TCPAddr{IP: net.IPv4(10, 1, 2, 3), Port: 51000}
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if err := m.CheckConnection(addr); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+func benchApplyWAF(b *testing.B) {
+	m := benchSecurityManager()
+	req, err := http.NewRequest(http.MethodGet, "http://gateway/api/v1/player?id=12345", nil)
+	if err != nil {
+		b.Fatal(err)
+	}
+	req.RemoteAddr = "10.1.2.3:51000"
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if err := m.ApplyWAF(req); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+func benchLoggerLog(b *testing.B) {
+	// A huge batch and flush interval keep the consumer from spamming flush
+	// output mid-benchmark; the measured path is Get + fill + enqueue, which
+	// is exactly what a proxied request pays.
+	middleware.InitLogger(1<<16, 1<<20, time.Hour)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		entry := middleware.GetAccessLog()
+		entry.Timestamp = time.Now()
+		entry.ClientIP = "10.1.2.3"
+		entry.Protocol = "http"
+		entry.Method = "GET"
+		entry.Path = "/api/v1/player"
+		entry.Status = 200
+		entry.DurationMs = 3
+		entry.BytesIn = 256
+		entry.BytesOut = 1024
+		middleware.Instance.Log(entry)
+	}
+}
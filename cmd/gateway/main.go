@@ -4,6 +4,7 @@ import (
 	"os"
 	"os/signal"
 	"syscall"
+	"time"
 
 	"github.com/SkynetNext/unified-access-gateway/internal/config"
 	"github.com/SkynetNext/unified-access-gateway/internal/core"
@@ -65,46 +66,70 @@ func main() {
 		}
 	}
 
-	// 5. Initialize Redis config store (REQUIRED for business config)
-	var redisStore *config.RedisStore
-	if cfg.Security.Redis.Enabled {
-		store, err := config.NewRedisStore(&cfg.Security.Redis)
-		if err != nil {
-			xlog.Errorf("CRITICAL: Failed to connect to Redis: %v", err)
-			xlog.Errorf("Gateway cannot start without Redis. Business config is unavailable.")
-			os.Exit(1)
-		}
-		redisStore = store
+	// 5. Initialize Redis config store (primary source of business config)
+	// Every successful Redis load also refreshes a local snapshot, so when
+	// Redis is unreachable during a restart the gateway boots from the
+	// snapshot (pure local read) and reconciles in the background instead of
+	// coming up with zero capacity.
+	if !cfg.Security.Redis.Enabled {
+		xlog.Errorf("CRITICAL: Redis is disabled. Gateway requires Redis for business config.")
+		os.Exit(1)
+	}
 
+	redisStore, err := config.NewRedisStore(&cfg.Security.Redis)
+	if err != nil {
+		xlog.Warnf("Failed to connect to Redis: %v (trying local config snapshot)", err)
+	}
+
+	configLoaded := false
+	if redisStore != nil {
 		// 6. Load Business Configuration from Redis (READ-ONLY)
 		businessCfg, err := redisStore.LoadBusinessConfig()
 		if err != nil {
-			xlog.Errorf("CRITICAL: Failed to load business config from Redis: %v", err)
+			xlog.Warnf("Failed to load business config from Redis: %v (trying local config snapshot)", err)
+		} else {
+			// Apply business config to main config
+			cfg.Server = businessCfg.Server
+			cfg.Backends = businessCfg.Backends
+			cfg.Lifecycle = businessCfg.Lifecycle
+			configLoaded = true
+			xlog.Infof("Business config loaded from Redis: listen=%s, http_backend=%s, tcp_backend=%s",
+				cfg.Server.ListenAddr, cfg.Backends.HTTP.TargetURL, cfg.Backends.TCP.TargetAddr)
+
+			// 7. Load Security Configuration from Redis (READ-ONLY)
+			securityCfg, err := redisStore.LoadSecurityConfig()
+			if err != nil {
+				xlog.Warnf("Failed to load security config from Redis: %v (using defaults)", err)
+			} else {
+				cfg.Security.Auth = securityCfg.Auth
+				cfg.Security.RateLimit = securityCfg.RateLimit
+				cfg.Security.WAF = securityCfg.WAF
+				xlog.Infof("Security config loaded from Redis: rate_limit=%v, waf=%v",
+					cfg.Security.RateLimit.Enabled, cfg.Security.WAF.Enabled)
+			}
+		}
+	}
+
+	if !configLoaded {
+		// Redis (or its config) is unavailable: boot from the last persisted
+		// snapshot and keep retrying Redis in the background.
+		snap, err := config.LoadSnapshot()
+		if err != nil || snap.Business == nil {
+			xlog.Errorf("CRITICAL: Redis unavailable and no usable local config snapshot at %s: %v", config.SnapshotPath(), err)
 			xlog.Errorf("Gateway cannot start. Please configure business config in Redis first.")
 			os.Exit(1)
 		}
-
-		// Apply business config to main config
-		cfg.Server = businessCfg.Server
-		cfg.Backends = businessCfg.Backends
-		cfg.Lifecycle = businessCfg.Lifecycle
-		xlog.Infof("Business config loaded from Redis: listen=%s, http_backend=%s, tcp_backend=%s",
-			cfg.Server.ListenAddr, cfg.Backends.HTTP.TargetURL, cfg.Backends.TCP.TargetAddr)
-
-		// 7. Load Security Configuration from Redis (READ-ONLY)
-		securityCfg, err := redisStore.LoadSecurityConfig()
-		if err != nil {
-			xlog.Warnf("Failed to load security config from Redis: %v (using defaults)", err)
-		} else {
-			cfg.Security.Auth = securityCfg.Auth
-			cfg.Security.RateLimit = securityCfg.RateLimit
-			cfg.Security.WAF = securityCfg.WAF
-			xlog.Infof("Security config loaded from Redis: rate_limit=%v, waf=%v",
-				cfg.Security.RateLimit.Enabled, cfg.Security.WAF.Enabled)
+		cfg.Server = snap.Business.Server
+		cfg.Backends = snap.Business.Backends
+		cfg.Lifecycle = snap.Business.Lifecycle
+		if snap.Security != nil {
+			cfg.Security.Auth = snap.Security.Auth
+			cfg.Security.RateLimit = snap.Security.RateLimit
+			cfg.Security.WAF = snap.Security.WAF
 		}
-	} else {
-		xlog.Errorf("CRITICAL: Redis is disabled. Gateway requires Redis for business config.")
-		os.Exit(1)
+		xlog.Warnf("Booted from local config snapshot (saved %s): listen=%s", snap.SavedAt.Format(time.RFC3339), cfg.Server.ListenAddr)
+		xlog.Warnf("Runtime config updates are unavailable until Redis returns; refreshed business config applies on the next restart")
+		go reconcileWithRedis(&cfg.Security.Redis)
 	}
 
 	// 8. Initialize Server with configuration
@@ -125,3 +150,30 @@ func main() {
 
 	xlog.Infof("Server exited successfully.")
 }
+
+// reconcileWithRedis retries Redis after a snapshot boot and refreshes the
+// local snapshot once it comes back (the Load* calls persist it). Business
+// config is only applied at startup, so the refreshed snapshot takes effect
+// on the next restart; the reconciler's job is making sure that restart
+// boots with current data.
+func reconcileWithRedis(redisCfg *config.RedisConfig) {
+	for {
+		time.Sleep(30 * time.Second)
+		store, err := config.NewRedisStore(redisCfg)
+		if err != nil {
+			xlog.Debugf("Redis still unavailable: %v", err)
+			continue
+		}
+		if _, err := store.LoadBusinessConfig(); err != nil {
+			xlog.Warnf("Redis reachable but business config load failed: %v", err)
+			store.Close()
+			continue
+		}
+		if _, err := store.LoadSecurityConfig(); err != nil {
+			xlog.Warnf("Failed to refresh security config snapshot: %v", err)
+		}
+		store.Close()
+		xlog.Infof("Redis reachable again; local config snapshot refreshed (restart to apply changes)")
+		return
+	}
+}
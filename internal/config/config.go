@@ -20,22 +20,48 @@ type Config struct {
 	// Infrastructure Configuration
 	Metrics  MetricsConfig  `yaml:"metrics"`  // Prometheus metrics server
 	Security SecurityConfig `yaml:"security"` // Redis, Auth, WAF (affects readiness)
+	TLS      TLSConfig      `yaml:"tls"`      // TLS termination (certs are mounted files)
 }
 
 // ServerConfig - Business Configuration
 // Controls gateway's listening address and connection limits
 type ServerConfig struct {
 	ListenAddr string `yaml:"listen_addr" env:"GATEWAY_LISTEN_ADDR"` // Business: Listening port
+	// UDP listening address (empty = UDP side disabled)
+	UDPListenAddr string `yaml:"udp_listen_addr" env:"GATEWAY_UDP_LISTEN_ADDR"` // Business: UDP listening port
 	// Maximum concurrent connections
 	MaxConnections int `yaml:"max_connections" env:"GATEWAY_MAX_CONNECTIONS"` // Business: Max online connections
+	// Number of parallel accept loops over SO_REUSEPORT listeners
+	// (0 = one per GOMAXPROCS; forced to 1 where SO_REUSEPORT is unavailable)
+	AcceptLoops int `yaml:"accept_loops" env:"GATEWAY_ACCEPT_LOOPS"` // Business: Accept loop count
+	// Capacity of the eBPF sockmap maps (0 = built-in default of 65535).
+	// Each proxied connection uses two entries, so size this to at least
+	// 2x the expected concurrent connection count.
+	SockMapMaxEntries int `yaml:"sockmap_max_entries" env:"GATEWAY_SOCKMAP_MAX_ENTRIES"` // Business: eBPF map capacity
+	// Extra magic-byte rules for the protocol sniffer, each entry
+	// "<hex-prefix>:<http|tls|tcp>" (e.g. "c0ffee:tcp"), so a game's
+	// handshake signature can be added without rebuilding the binary
+	ProtocolMagics []string `yaml:"protocol_magics" env:"GATEWAY_PROTOCOL_MAGICS"` // Business: Sniffer magic rules
 }
 
 // MetricsConfig - Infrastructure Configuration
 // Prometheus metrics server configuration
 // If metrics server fails, gateway continues running but monitoring is unavailable
 type MetricsConfig struct {
-	Enabled    bool   `yaml:"enabled" env:"METRICS_ENABLED"`           // Infrastructure: Enable metrics
-	ListenAddr string `yaml:"listen_addr" env:"METRICS_LISTEN_ADDR"`    // Infrastructure: Metrics port
+	Enabled      bool   `yaml:"enabled" env:"METRICS_ENABLED"`             // Infrastructure: Enable metrics
+	ListenAddr   string `yaml:"listen_addr" env:"METRICS_LISTEN_ADDR"`     // Infrastructure: Metrics port
+	PprofEnabled bool   `yaml:"pprof_enabled" env:"METRICS_PPROF_ENABLED"` // Infrastructure: Profiling endpoints on the metrics server
+}
+
+// TLSConfig - Infrastructure Configuration
+// In-process TLS termination for sniffed TLS connections. Certificates are
+// deployment artifacts (mounted Secrets), so this is env-driven like Redis,
+// not Redis-driven like forwarding rules. When disabled, TLS clients are
+// rejected at dispatch.
+type TLSConfig struct {
+	Enabled  bool   `yaml:"enabled" env:"GATEWAY_TLS_ENABLED"`     // Infrastructure: Enable TLS termination
+	CertFile string `yaml:"cert_file" env:"GATEWAY_TLS_CERT_FILE"` // Infrastructure: PEM certificate chain
+	KeyFile  string `yaml:"key_file" env:"GATEWAY_TLS_KEY_FILE"`   // Infrastructure: PEM private key
 }
 
 // BackendsConfig - Business Configuration
@@ -43,20 +69,86 @@ type MetricsConfig struct {
 type BackendsConfig struct {
 	HTTP HTTPBackend `yaml:"http"` // Business: HTTP forwarding rules
 	TCP  TCPBackend  `yaml:"tcp"`  // Business: TCP forwarding rules
+	UDP  UDPBackend  `yaml:"udp"`  // Business: UDP/QUIC forwarding rules
 }
 
 // HTTPBackend - Business Configuration
 // HTTP backend service forwarding configuration
 type HTTPBackend struct {
-	TargetURL string        `yaml:"target_url" env:"HTTP_BACKEND_URL"`       // Business: Backend URL
-	Timeout   time.Duration `yaml:"timeout" env:"HTTP_BACKEND_TIMEOUT"`      // Business: Request timeout
+	TargetURL  string        `yaml:"target_url" env:"HTTP_BACKEND_URL"`   // Business: Backend URL
+	TargetURLs []string      `yaml:"target_urls" env:"HTTP_BACKEND_URLS"` // Business: Backend URL pool (least-connections balanced)
+	Timeout    time.Duration `yaml:"timeout" env:"HTTP_BACKEND_TIMEOUT"`  // Business: Request timeout
+	// K8s service ("name:port") whose endpoint IPs feed the backend set at
+	// runtime; the static list above remains the initial/fallback set
+	DiscoveryService string `yaml:"discovery_service" env:"HTTP_BACKEND_DISCOVERY_SERVICE"` // Business: K8s endpoint discovery
+	// Upstream connection pool tuning for the shared transport. Zero values
+	// fall back to the handler defaults (512 / 128 / 90s); size per-host to
+	// the expected concurrency toward a single backend.
+	MaxIdleConns        int           `yaml:"max_idle_conns" env:"HTTP_BACKEND_MAX_IDLE_CONNS"`                   // Business: Idle upstream connections, all backends
+	MaxIdleConnsPerHost int           `yaml:"max_idle_conns_per_host" env:"HTTP_BACKEND_MAX_IDLE_CONNS_PER_HOST"` // Business: Idle upstream connections per backend
+	IdleConnTimeout     time.Duration `yaml:"idle_conn_timeout" env:"HTTP_BACKEND_IDLE_CONN_TIMEOUT"`             // Business: Idle upstream connection lifetime
+}
+
+// Targets returns the effective HTTP backend list: the pool when configured,
+// otherwise the single target for backward compatibility.
+func (b *HTTPBackend) Targets() []string {
+	if len(b.TargetURLs) > 0 {
+		return b.TargetURLs
+	}
+	if b.TargetURL != "" {
+		return []string{b.TargetURL}
+	}
+	return nil
 }
 
 // TCPBackend - Business Configuration
 // TCP backend service forwarding configuration
 type TCPBackend struct {
-	TargetAddr string        `yaml:"target_addr" env:"TCP_BACKEND_ADDR"`    // Business: Backend address
-	Timeout    time.Duration `yaml:"timeout" env:"TCP_BACKEND_TIMEOUT"`       // Business: Connection timeout
+	TargetAddr  string        `yaml:"target_addr" env:"TCP_BACKEND_ADDR"`   // Business: Backend address
+	TargetAddrs []string      `yaml:"target_addrs" env:"TCP_BACKEND_ADDRS"` // Business: Backend address pool (least-connections balanced)
+	Timeout     time.Duration `yaml:"timeout" env:"TCP_BACKEND_TIMEOUT"`    // Business: Connection timeout
+	// Emit a PROXY v2 header with the real client address on each backend
+	// connection so backends stop resolving the client themselves
+	ProxyProtocol bool `yaml:"proxy_protocol" env:"TCP_BACKEND_PROXY_PROTOCOL"` // Business: PROXY v2 emission
+	// Reconnecting clients are routed back to the backend that served them
+	// within this window (session affinity); 0 disables affinity entirely
+	AffinityTTL time.Duration `yaml:"affinity_ttl" env:"TCP_BACKEND_AFFINITY_TTL"` // Business: Session affinity window
+	// K8s service ("name:port") whose endpoint IPs feed the backend set at
+	// runtime; the static list above remains the initial/fallback set
+	DiscoveryService string `yaml:"discovery_service" env:"TCP_BACKEND_DISCOVERY_SERVICE"` // Business: K8s endpoint discovery
+}
+
+// Targets returns the effective TCP backend list: the pool when configured,
+// otherwise the single target for backward compatibility.
+func (b *TCPBackend) Targets() []string {
+	if len(b.TargetAddrs) > 0 {
+		return b.TargetAddrs
+	}
+	if b.TargetAddr != "" {
+		return []string{b.TargetAddr}
+	}
+	return nil
+}
+
+// UDPBackend - Business Configuration
+// UDP backend forwarding configuration (QUIC passthrough / raw UDP sessions)
+type UDPBackend struct {
+	TargetAddr  string   `yaml:"target_addr" env:"UDP_BACKEND_ADDR"`   // Business: Backend address
+	TargetAddrs []string `yaml:"target_addrs" env:"UDP_BACKEND_ADDRS"` // Business: Backend address pool (least-connections balanced)
+	// Sessions with no traffic in either direction for this long are torn down
+	IdleTimeout time.Duration `yaml:"idle_timeout" env:"UDP_BACKEND_IDLE_TIMEOUT"` // Business: Session idle timeout
+}
+
+// Targets returns the effective UDP backend list: the pool when configured,
+// otherwise the single target for backward compatibility.
+func (b *UDPBackend) Targets() []string {
+	if len(b.TargetAddrs) > 0 {
+		return b.TargetAddrs
+	}
+	if b.TargetAddr != "" {
+		return []string{b.TargetAddr}
+	}
+	return nil
 }
 
 // LifecycleConfig - Business Configuration
@@ -108,6 +200,9 @@ type RateLimitConfig struct {
 type AuditConfig struct {
 	Enabled bool   `yaml:"enabled" env:"AUDIT_ENABLED"`
 	Sink    string `yaml:"sink" env:"AUDIT_SINK"`
+	// Fraction of allowed requests to audit (0..1]. Denies are always
+	// logged. 1.0 (the default) audits everything.
+	SampleRate float64 `yaml:"sample_rate" env:"AUDIT_SAMPLE_RATE"`
 }
 
 type WAFConfig struct {
@@ -130,8 +225,9 @@ func DefaultSecurityState() SecurityConfig {
 			Burst:             200,
 		},
 		Audit: AuditConfig{
-			Enabled: true,
-			Sink:    "stdout",
+			Enabled:    true,
+			Sink:       "stdout",
+			SampleRate: 1.0,
 		},
 		WAF: WAFConfig{
 			Enabled:         false,
@@ -156,13 +252,18 @@ func LoadConfig() *Config {
 		Metrics: MetricsConfig{
 			Enabled:    getEnvBool("METRICS_ENABLED", true),
 			ListenAddr: getEnv("METRICS_LISTEN_ADDR", ":9090"),
+			// The metrics port is cluster-internal, so the profiling surface
+			// defaults on; incidents are exactly when a redeploy to enable it
+			// would lose the evidence.
+			PprofEnabled: getEnvBool("METRICS_PPROF_ENABLED", true),
 		},
 		Security: SecurityConfig{
 			Auth:      defaultSecurity.Auth,
 			RateLimit: defaultSecurity.RateLimit,
 			Audit: AuditConfig{
-				Enabled: getEnvBool("AUDIT_ENABLED", defaultSecurity.Audit.Enabled),
-				Sink:    getEnv("AUDIT_SINK", defaultSecurity.Audit.Sink),
+				Enabled:    getEnvBool("AUDIT_ENABLED", defaultSecurity.Audit.Enabled),
+				Sink:       getEnv("AUDIT_SINK", defaultSecurity.Audit.Sink),
+				SampleRate: getEnvFloat("AUDIT_SAMPLE_RATE", defaultSecurity.Audit.SampleRate),
 			},
 			WAF: defaultSecurity.WAF,
 			Redis: RedisConfig{
@@ -173,6 +274,11 @@ func LoadConfig() *Config {
 				KeyPrefix: getEnv("REDIS_KEY_PREFIX", "gateway:"),
 			},
 		},
+		TLS: TLSConfig{
+			Enabled:  getEnvBool("GATEWAY_TLS_ENABLED", false),
+			CertFile: getEnv("GATEWAY_TLS_CERT_FILE", ""),
+			KeyFile:  getEnv("GATEWAY_TLS_KEY_FILE", ""),
+		},
 	}
 }
 
@@ -5,6 +5,8 @@ import (
 	"encoding/json"
 	"errors"
 	"fmt"
+	"strings"
+	"sync"
 	"time"
 
 	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
@@ -25,6 +27,7 @@ type RedisStore struct {
 	ctx     context.Context
 	pubsub  *redis.PubSub
 	updates chan ConfigUpdate
+	snapMu  sync.Mutex // serializes local snapshot writes
 }
 
 // ConfigUpdate represents a configuration change notification from Redis pub/sub
@@ -158,26 +161,82 @@ func (r *RedisStore) LoadBusinessConfig() (*BusinessConfig, error) {
 	if v, ok := result["server.max_connections"]; ok && v != "" {
 		fmt.Sscanf(v, "%d", &cfg.Server.MaxConnections)
 	}
+	if v, ok := result["server.accept_loops"]; ok && v != "" {
+		fmt.Sscanf(v, "%d", &cfg.Server.AcceptLoops)
+	}
+	if v, ok := result["server.sockmap_max_entries"]; ok && v != "" {
+		fmt.Sscanf(v, "%d", &cfg.Server.SockMapMaxEntries)
+	}
+	if v, ok := result["server.udp_listen_addr"]; ok && v != "" {
+		cfg.Server.UDPListenAddr = v
+	}
+	if v, ok := result["server.protocol_magics"]; ok && v != "" {
+		cfg.Server.ProtocolMagics = splitList(v)
+	}
 
 	// HTTP Backend
 	if v, ok := result["backends.http.target_url"]; ok && v != "" {
 		cfg.Backends.HTTP.TargetURL = v
 	}
+	if v, ok := result["backends.http.target_urls"]; ok && v != "" {
+		cfg.Backends.HTTP.TargetURLs = splitList(v)
+	}
 	if v, ok := result["backends.http.timeout"]; ok && v != "" {
 		if d, err := time.ParseDuration(v); err == nil {
 			cfg.Backends.HTTP.Timeout = d
 		}
 	}
+	if v, ok := result["backends.http.discovery_service"]; ok && v != "" {
+		cfg.Backends.HTTP.DiscoveryService = v
+	}
+	if v, ok := result["backends.http.max_idle_conns"]; ok && v != "" {
+		fmt.Sscanf(v, "%d", &cfg.Backends.HTTP.MaxIdleConns)
+	}
+	if v, ok := result["backends.http.max_idle_conns_per_host"]; ok && v != "" {
+		fmt.Sscanf(v, "%d", &cfg.Backends.HTTP.MaxIdleConnsPerHost)
+	}
+	if v, ok := result["backends.http.idle_conn_timeout"]; ok && v != "" {
+		if d, err := time.ParseDuration(v); err == nil {
+			cfg.Backends.HTTP.IdleConnTimeout = d
+		}
+	}
 
 	// TCP Backend
 	if v, ok := result["backends.tcp.target_addr"]; ok && v != "" {
 		cfg.Backends.TCP.TargetAddr = v
 	}
+	if v, ok := result["backends.tcp.target_addrs"]; ok && v != "" {
+		cfg.Backends.TCP.TargetAddrs = splitList(v)
+	}
+	if v, ok := result["backends.tcp.proxy_protocol"]; ok && v != "" {
+		cfg.Backends.TCP.ProxyProtocol = v == "1" || v == "true"
+	}
 	if v, ok := result["backends.tcp.timeout"]; ok && v != "" {
 		if d, err := time.ParseDuration(v); err == nil {
 			cfg.Backends.TCP.Timeout = d
 		}
 	}
+	if v, ok := result["backends.tcp.affinity_ttl"]; ok && v != "" {
+		if d, err := time.ParseDuration(v); err == nil {
+			cfg.Backends.TCP.AffinityTTL = d
+		}
+	}
+	if v, ok := result["backends.tcp.discovery_service"]; ok && v != "" {
+		cfg.Backends.TCP.DiscoveryService = v
+	}
+
+	// UDP Backend
+	if v, ok := result["backends.udp.target_addr"]; ok && v != "" {
+		cfg.Backends.UDP.TargetAddr = v
+	}
+	if v, ok := result["backends.udp.target_addrs"]; ok && v != "" {
+		cfg.Backends.UDP.TargetAddrs = splitList(v)
+	}
+	if v, ok := result["backends.udp.idle_timeout"]; ok && v != "" {
+		if d, err := time.ParseDuration(v); err == nil {
+			cfg.Backends.UDP.IdleTimeout = d
+		}
+	}
 
 	// Lifecycle config
 	if v, ok := result["lifecycle.shutdown_timeout"]; ok && v != "" {
@@ -191,9 +250,68 @@ func (r *RedisStore) LoadBusinessConfig() (*BusinessConfig, error) {
 		}
 	}
 
+	// Refresh the local snapshot so the next restart can boot through a
+	// Redis outage.
+	r.persistSnapshot(cfg, nil)
+
 	return cfg, nil
 }
 
+// splitList parses a comma-separated backend list stored as a single hash
+// field, trimming whitespace and dropping empty entries.
+func splitList(v string) []string {
+	parts := strings.Split(v, ",")
+	out := make([]string, 0, len(parts))
+	for _, part := range parts {
+		if trimmed := strings.TrimSpace(part); trimmed != "" {
+			out = append(out, trimmed)
+		}
+	}
+	return out
+}
+
+// =============================================================================
+// Session Affinity State - gateway-owned runtime state
+// =============================================================================
+// Unlike the configuration namespaces above, "affinity:" keys are runtime
+// state the gateway itself produces (client -> backend mappings that must
+// survive a pod restart). Writing them does not violate the READ-ONLY config
+// contract: external admin tools never manage these keys, and the TTL on
+// every entry keeps the namespace self-cleaning.
+
+// affinityOpTimeout bounds each affinity read/write. The callers are the
+// affinity cache's background loops, never the accept path, but without a
+// per-call deadline a hung Redis would back those loops up indefinitely.
+const affinityOpTimeout = 200 * time.Millisecond
+
+// AffinityGet returns the persisted backend for a client key, if any.
+func (r *RedisStore) AffinityGet(key string) (string, bool) {
+	if r == nil {
+		return "", false
+	}
+	ctx, cancel := context.WithTimeout(r.ctx, affinityOpTimeout)
+	defer cancel()
+	v, err := r.client.Get(ctx, r.prefix+"affinity:"+key).Result()
+	if err != nil || v == "" {
+		return "", false
+	}
+	return v, true
+}
+
+// AffinitySet persists a client -> backend mapping with the given TTL.
+// Best-effort: a Redis hiccup only loses cross-restart affinity, the local
+// in-memory cache keeps serving.
+func (r *RedisStore) AffinitySet(key, backend string, ttl time.Duration) {
+	if r == nil {
+		return
+	}
+	ctx, cancel := context.WithTimeout(r.ctx, affinityOpTimeout)
+	defer cancel()
+	if err := r.client.Set(ctx, r.prefix+"affinity:"+key, backend, ttl).Err(); err != nil {
+		xlog.Debugf("Failed to persist affinity %s -> %s: %v", key, backend, err)
+	}
+}
+
 // =============================================================================
 // Security Configuration - READ ONLY
 // =============================================================================
@@ -252,5 +370,9 @@ func (r *RedisStore) LoadSecurityConfig() (*SecurityConfig, error) {
 		cfg.WAF.BlockedPatterns = patterns
 	}
 
+	// Refresh the local snapshot so the next restart can boot through a
+	// Redis outage.
+	r.persistSnapshot(nil, &cfg)
+
 	return &cfg, nil
 }
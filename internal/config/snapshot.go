@@ -0,0 +1,90 @@
+package config
+
+import (
+	"encoding/json"
+	"fmt"
+	"os"
+	"path/filepath"
+	"time"
+
+	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
+)
+
+// Local persistent snapshot of the last configuration successfully loaded
+// from Redis. Startup can boot from it in milliseconds when Redis is down
+// (a pure local read), then reconcile with Redis in the background, so a
+// rolling restart during a Redis blip no longer takes the fleet to zero.
+
+// defaultSnapshotPath should sit on a volume that survives container
+// restarts (an emptyDir survives restarts within the pod; a hostPath or PVC
+// survives rescheduling too).
+const defaultSnapshotPath = "/var/lib/uag/config-snapshot.json"
+
+// SnapshotPath returns where the local config snapshot is persisted.
+func SnapshotPath() string {
+	return getEnv("GATEWAY_CONFIG_SNAPSHOT", defaultSnapshotPath)
+}
+
+// ConfigSnapshot is the on-disk mirror of the Redis-held configuration.
+// Only the sections Redis actually serves are stored; infrastructure config
+// (metrics, Redis connection, TLS certs) stays env-driven.
+type ConfigSnapshot struct {
+	SavedAt  time.Time       `json:"saved_at"`
+	Business *BusinessConfig `json:"business,omitempty"`
+	Security *SecurityConfig `json:"security,omitempty"`
+}
+
+// LoadSnapshot reads the persisted snapshot without touching Redis.
+func LoadSnapshot() (*ConfigSnapshot, error) {
+	path := SnapshotPath()
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return nil, err
+	}
+	snap := &ConfigSnapshot{}
+	if err := json.Unmarshal(data, snap); err != nil {
+		return nil, fmt.Errorf("parsing config snapshot %s: %w", path, err)
+	}
+	return snap, nil
+}
+
+// SaveSnapshot persists snap atomically (temp file + rename), so a crash
+// mid-write can never leave a truncated snapshot behind.
+func SaveSnapshot(snap *ConfigSnapshot) error {
+	path := SnapshotPath()
+	if err := os.MkdirAll(filepath.Dir(path), 0o755); err != nil {
+		return err
+	}
+	snap.SavedAt = time.Now()
+	data, err := json.MarshalIndent(snap, "", "  ")
+	if err != nil {
+		return err
+	}
+	tmp := path + ".tmp"
+	if err := os.WriteFile(tmp, data, 0o644); err != nil {
+		return err
+	}
+	return os.Rename(tmp, path)
+}
+
+// persistSnapshot merges a freshly loaded section into the on-disk snapshot.
+// Called after every successful Redis load; failures only log, the cache is
+// strictly best-effort and never blocks serving.
+func (r *RedisStore) persistSnapshot(business *BusinessConfig, security *SecurityConfig) {
+	r.snapMu.Lock()
+	defer r.snapMu.Unlock()
+
+	snap, err := LoadSnapshot()
+	if err != nil {
+		snap = &ConfigSnapshot{}
+	}
+	if business != nil {
+		snap.Business = business
+	}
+	if security != nil {
+		snap.Security = security
+	}
+	if err := SaveSnapshot(snap); err != nil {
+		xlog.Warnf("Failed to persist config snapshot to %s: %v", SnapshotPath(), err)
+	}
+}
@@ -0,0 +1,35 @@
+//go:build linux
+// +build linux
+
+package core
+
+import (
+	"context"
+	"net"
+	"syscall"
+)
+
+// soReusePort is SO_REUSEPORT, which the syscall package does not export.
+const soReusePort = 0xf
+
+// reusePortSupported reports whether multiple accept loops can bind the
+// same address on this platform.
+const reusePortSupported = true
+
+// listenReusePort opens a TCP listener with SO_REUSEPORT set, so several
+// listeners can share one address and the kernel spreads incoming
+// connections across their accept queues.
+func listenReusePort(address string) (net.Listener, error) {
+	lc := net.ListenConfig{
+		Control: func(network, address string, c syscall.RawConn) error {
+			var sockErr error
+			if err := c.Control(func(fd uintptr) {
+				sockErr = syscall.SetsockoptInt(int(fd), syscall.SOL_SOCKET, soReusePort, 1)
+			}); err != nil {
+				return err
+			}
+			return sockErr
+		},
+	}
+	return lc.Listen(context.Background(), "tcp", address)
+}
@@ -0,0 +1,14 @@
+//go:build !linux
+// +build !linux
+
+package core
+
+import "net"
+
+// SO_REUSEPORT load spreading is Linux-only; other platforms fall back to a
+// single accept loop.
+const reusePortSupported = false
+
+func listenReusePort(address string) (net.Listener, error) {
+	return net.Listen("tcp", address)
+}
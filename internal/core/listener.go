@@ -1,39 +1,158 @@
 package core
 
 import (
+	"crypto/tls"
 	"errors"
 	"fmt"
 	"net"
+	"runtime"
 	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
 
 	"github.com/SkynetNext/unified-access-gateway/internal/config"
+	"github.com/SkynetNext/unified-access-gateway/internal/middleware"
 	httpproxy "github.com/SkynetNext/unified-access-gateway/internal/protocol/http"
 	tcpproxy "github.com/SkynetNext/unified-access-gateway/internal/protocol/tcp"
 	"github.com/SkynetNext/unified-access-gateway/internal/security"
 	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
 )
 
+// Dispatch pool sizing. Workers own the short sniff/security/dispatch stage
+// only (sessions get their own goroutine), so a fixed pool replaces the
+// per-connection accept goroutine and its stack churn. The queue absorbs
+// accept bursts; if it fills anyway (e.g. many clients stalling the sniff
+// deadline at once), the accept loop degrades to spawning directly instead
+// of stalling or dropping.
+const (
+	dispatchQueueSize     = 4096
+	dispatchWorkersPerCPU = 16
+)
+
 type Listener struct {
-	address  string
-	listener net.Listener
+	address    string
+	listeners  []net.Listener
+	dispatchCh chan net.Conn
 
-	cfg      *config.Config
-	security *security.Manager
+	cfg       *config.Config
+	security  *security.Manager
+	tlsConfig *tls.Config
 
 	httpHandler *httpproxy.Handler
 	tcpHandler  *tcpproxy.Handler
+
+	// Registry of live accepted connections, maintained by trackedConn, so
+	// graceful shutdown can wait for the exact moment the count hits zero
+	// (and force-close stragglers) instead of sleeping out the worst case.
+	// Costs one counter op and one sync.Map store/delete per connection.
+	activeConns atomic.Int64
+	conns       sync.Map // *trackedConn -> struct{}
+	drainCh     chan struct{}
+}
+
+// trackedConn registers a connection's lifetime with the listener: accept
+// increments the registry, the first Close decrements it — no matter which
+// component (TCP relay, shared HTTP server, TLS layer) ends up owning the
+// close, and no matter how many layers close redundantly.
+type trackedConn struct {
+	net.Conn
+	listener   *Listener
+	acceptedAt time.Time // set at accept; measures queue wait to sniff
+	closed     atomic.Bool
+}
+
+func (c *trackedConn) Close() error {
+	if c.closed.CompareAndSwap(false, true) {
+		c.listener.connDone(c)
+	}
+	return c.Conn.Close()
+}
+
+// Unwrap keeps the splice fast path and socket-cookie extraction working:
+// callers needing the raw *net.TCPConn peel wrappers off layer by layer.
+func (c *trackedConn) Unwrap() net.Conn { return c.Conn }
+
+func (l *Listener) track(c net.Conn) net.Conn {
+	tc := &trackedConn{Conn: c, listener: l, acceptedAt: time.Now()}
+	l.activeConns.Add(1)
+	l.conns.Store(tc, struct{}{})
+	return tc
+}
+
+func (l *Listener) connDone(tc *trackedConn) {
+	l.conns.Delete(tc)
+	if l.activeConns.Add(-1) == 0 {
+		select {
+		case l.drainCh <- struct{}{}:
+		default:
+		}
+	}
+}
+
+// ActiveConns returns the number of live accepted connections.
+func (l *Listener) ActiveConns() int64 {
+	return l.activeConns.Load()
+}
+
+// Drain blocks until every tracked connection has closed or the deadline
+// passes, and returns how many are still open. Call after Stop so no new
+// connections register while draining.
+func (l *Listener) Drain(timeout time.Duration) int64 {
+	if l.activeConns.Load() == 0 {
+		return 0
+	}
+	deadline := time.NewTimer(timeout)
+	defer deadline.Stop()
+	for {
+		select {
+		case <-l.drainCh:
+			// Re-check: the signal may be stale from an earlier zero crossing.
+			if l.activeConns.Load() == 0 {
+				return 0
+			}
+		case <-deadline.C:
+			return l.activeConns.Load()
+		}
+	}
 }
 
-func NewListener(cfg *config.Config, sec *security.Manager) *Listener {
+// CloseActive force-closes every connection still tracked; used for
+// stragglers that outlive the drain deadline.
+func (l *Listener) CloseActive() {
+	l.conns.Range(func(k, _ any) bool {
+		k.(*trackedConn).Close()
+		return true
+	})
+}
+
+func NewListener(cfg *config.Config, sec *security.Manager, store *config.RedisStore) *Listener {
 	l := &Listener{
 		address:  cfg.Server.ListenAddr,
 		cfg:      cfg,
 		security: sec,
+		drainCh:  make(chan struct{}, 1),
 	}
 
+	// Feed operator-supplied magic rules into the sniffer table before any
+	// connection can be sniffed.
+	RegisterConfiguredMagics(cfg.Server.ProtocolMagics)
+
 	// Create handlers (may return nil if config is missing)
 	l.httpHandler = httpproxy.NewHandler(cfg, sec)
-	l.tcpHandler = tcpproxy.NewHandler(cfg, sec)
+	l.tcpHandler = tcpproxy.NewHandler(cfg, sec, store)
+
+	// TLS termination is optional; without it, sniffed TLS connections are
+	// rejected at dispatch.
+	if cfg.TLS.Enabled {
+		tlsCfg, err := newTLSConfig(&cfg.TLS)
+		if err != nil {
+			xlog.Errorf("CRITICAL: Failed to load TLS certificate (cert=%s): %v", cfg.TLS.CertFile, err)
+		} else {
+			l.tlsConfig = tlsCfg
+			xlog.Infof("TLS termination enabled (cert: %s)", cfg.TLS.CertFile)
+		}
+	}
 
 	return l
 }
@@ -50,27 +169,68 @@ func (l *Listener) Start() error {
 		return fmt.Errorf("listen address not configured")
 	}
 
-	var err error
-	l.listener, err = net.Listen("tcp", l.address)
-	if err != nil {
-		return err
+	// Multiple accept loops over SO_REUSEPORT listeners let the kernel
+	// spread accepts across cores instead of funneling every connection
+	// through one accept queue. Falls back to a single listener when the
+	// platform lacks SO_REUSEPORT.
+	count := l.cfg.Server.AcceptLoops
+	if count <= 0 {
+		count = runtime.GOMAXPROCS(0)
+	}
+	if !reusePortSupported {
+		count = 1
+	}
+
+	for i := 0; i < count; i++ {
+		var (
+			ln  net.Listener
+			err error
+		)
+		if count > 1 {
+			ln, err = listenReusePort(l.address)
+		} else {
+			ln, err = net.Listen("tcp", l.address)
+		}
+		if err != nil {
+			for _, open := range l.listeners {
+				open.Close()
+			}
+			l.listeners = nil
+			return err
+		}
+		l.listeners = append(l.listeners, ln)
+	}
+
+	workers := dispatchWorkersPerCPU * runtime.GOMAXPROCS(0)
+	l.dispatchCh = make(chan net.Conn, dispatchQueueSize)
+	for i := 0; i < workers; i++ {
+		go l.dispatchWorker()
 	}
 
-	xlog.Infof("Gateway listening on %s", l.address)
+	xlog.Infof("Gateway listening on %s (%d accept loops, %d dispatch workers)", l.address, count, workers)
 
-	go l.acceptLoop()
+	for _, ln := range l.listeners {
+		go l.acceptLoop(ln)
+	}
 	return nil
 }
 
+// dispatchWorker serves the sniff/dispatch stage for queued connections.
+func (l *Listener) dispatchWorker() {
+	for c := range l.dispatchCh {
+		l.handleConn(c)
+	}
+}
+
 func (l *Listener) Stop() {
-	if l.listener != nil {
-		l.listener.Close()
+	for _, ln := range l.listeners {
+		ln.Close()
 	}
 }
 
-func (l *Listener) acceptLoop() {
+func (l *Listener) acceptLoop(ln net.Listener) {
 	for {
-		conn, err := l.listener.Accept()
+		conn, err := ln.Accept()
 		if err != nil {
 			// Check if listener was closed (normal shutdown during graceful shutdown)
 			errStr := err.Error()
@@ -93,31 +253,58 @@ func (l *Listener) acceptLoop() {
 			return
 		}
 
-		go l.handleConn(conn)
+		// Wrap at accept so the drain registry and the accept-to-sniff
+		// stage clock both start before any queueing.
+		c := l.track(conn)
+		select {
+		case l.dispatchCh <- c:
+		default:
+			go l.handleConn(c)
+		}
 	}
 }
 
 func (l *Listener) handleConn(c net.Conn) {
+	// 1. Record queue wait (accept to start of sniff) and wrap connection
+	// (Support Peek). The conn arrives already tracked from acceptLoop; the
+	// fallback keeps direct callers registered too.
+	if tc, ok := c.(*trackedConn); ok {
+		middleware.ObserveAcceptToSniff(time.Since(tc.acceptedAt).Seconds())
+	} else {
+		c = l.track(c)
+	}
+	sniffConn := NewSniffConn(c)
+
+	// 2. Sniff protocol (Magic Bytes). This also strips any PROXY v2 header
+	// the fronting LB prepended, so the security check below screens the real
+	// client address instead of the LB's. The stage histogram makes slow
+	// first bytes visible: a client stalling toward the sniffer's 500ms
+	// read deadline shows up here, not as silence.
+	sniffStart := time.Now()
+	proto := sniffConn.Sniff()
+	middleware.ObserveSniff(time.Since(sniffStart).Seconds())
+
 	if l.security != nil {
-		if err := l.security.CheckConnection(c.RemoteAddr()); err != nil {
-			xlog.Warnf("Connection %s rejected: %v", c.RemoteAddr(), err)
-			l.security.AuditTCP(c.RemoteAddr().String(), "", false, err.Error())
+		checkStart := time.Now()
+		err := l.security.CheckConnection(sniffConn.RemoteAddr())
+		middleware.ObserveSecurityCheck(time.Since(checkStart).Seconds())
+		if err != nil {
+			xlog.Warnf("Connection %s rejected: %v", sniffConn.RemoteAddr(), err)
+			l.security.AuditTCP(sniffConn.RemoteAddr().String(), "", false, err.Error())
 			c.Close()
+			sniffConn.Release()
 			return
 		}
 	}
-	// 1. Wrap connection (Support Peek)
-	sniffConn := NewSniffConn(c)
 
-	// 2. Sniff protocol (Magic Bytes)
-	proto := sniffConn.Sniff()
-
-	// 3. Dispatch
+	// 3. Dispatch. Stages that outlive the dispatch itself (TCP sessions,
+	// TLS handshakes) get their own goroutine so they never pin a worker.
 	switch proto {
 	case ProtocolHTTP:
 		if l.httpHandler == nil {
 			xlog.Warnf("Conn %s -> HTTP but handler not configured, closing", c.RemoteAddr())
 			c.Close()
+			sniffConn.Release()
 			return
 		}
 		xlog.Debugf("Conn %s -> HTTP", c.RemoteAddr())
@@ -127,13 +314,22 @@ func (l *Listener) handleConn(c net.Conn) {
 		if l.tcpHandler == nil {
 			xlog.Warnf("Conn %s -> TCP but handler not configured, closing", c.RemoteAddr())
 			c.Close()
+			sniffConn.Release()
 			return
 		}
 		xlog.Debugf("Conn %s -> TCP", c.RemoteAddr())
-		l.tcpHandler.Handle(sniffConn)
+		go func() {
+			l.tcpHandler.Handle(sniffConn)
+			sniffConn.Release()
+		}()
+
+	case ProtocolTLS:
+		xlog.Debugf("Conn %s -> TLS", c.RemoteAddr())
+		go l.handleTLS(sniffConn)
 
 	default:
 		xlog.Warnf("Conn %s -> Unknown Protocol, closing", c.RemoteAddr())
 		c.Close()
+		sniffConn.Release()
 	}
 }
@@ -3,12 +3,15 @@ package core
 import (
 	"context"
 	"net/http"
+	"net/http/pprof"
 	"sync"
 	"sync/atomic"
 	"time"
 
 	"github.com/SkynetNext/unified-access-gateway/internal/config"
 	"github.com/SkynetNext/unified-access-gateway/internal/healthcheck"
+	"github.com/SkynetNext/unified-access-gateway/internal/observability"
+	"github.com/SkynetNext/unified-access-gateway/internal/protocol/udp"
 	"github.com/SkynetNext/unified-access-gateway/internal/security"
 	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
 	"github.com/prometheus/client_golang/prometheus/promhttp"
@@ -17,7 +20,8 @@ import (
 type Server struct {
 	cfg           *config.Config
 	listener      *Listener
-	draining      int32 // Atomic: 0=Running, 1=Draining
+	udpHandler    *udp.Handler // nil unless the UDP side is configured
+	draining      int32        // Atomic: 0=Running, 1=Draining
 	wg            sync.WaitGroup
 	security      *security.Manager
 	redisStore    *config.RedisStore
@@ -29,7 +33,8 @@ func NewServer(cfg *config.Config, store *config.RedisStore) *Server {
 	sec := security.NewManager(cfg, store)
 	return &Server{
 		cfg:        cfg,
-		listener:   NewListener(cfg, sec),
+		listener:   NewListener(cfg, sec, store),
+		udpHandler: udp.NewHandler(cfg, sec),
 		security:   sec,
 		redisStore: store,
 	}
@@ -43,6 +48,20 @@ func (s *Server) Start() {
 		mux.HandleFunc("/health", s.healthHandler)
 		mux.HandleFunc("/ready", s.readyHandler) // K8s Readiness Probe
 
+		// Profiling surface (config-gated). The metrics port is
+		// cluster-internal, so CPU/heap profiles and execution traces
+		// (/debug/pprof/trace?seconds=N) are pullable from a live pod
+		// during an incident, plus a continuous 1%-duty-cycle CPU sampler
+		// whose recent snapshots cover spikes after the fact.
+		if s.cfg.Metrics.PprofEnabled {
+			mux.HandleFunc("/debug/pprof/", pprof.Index)
+			mux.HandleFunc("/debug/pprof/cmdline", pprof.Cmdline)
+			mux.HandleFunc("/debug/pprof/profile", pprof.Profile)
+			mux.HandleFunc("/debug/pprof/symbol", pprof.Symbol)
+			mux.HandleFunc("/debug/pprof/trace", pprof.Trace)
+			mux.Handle("/debug/profile/continuous", observability.StartContinuousProfiler())
+		}
+
 		s.metricsServer = &http.Server{
 			Addr:    s.cfg.Metrics.ListenAddr,
 			Handler: mux,
@@ -70,6 +89,17 @@ func (s *Server) Start() {
 			xlog.Errorf("Failed to start listener: %v", err)
 		}
 	}()
+
+	// 4. Start UDP Listener (QUIC passthrough / raw UDP sessions, optional)
+	if s.udpHandler != nil {
+		s.wg.Add(1)
+		go func() {
+			defer s.wg.Done()
+			if err := s.udpHandler.ListenAndServe(); err != nil {
+				xlog.Errorf("Failed to start UDP listener: %v", err)
+			}
+		}()
+	}
 }
 
 // GracefulShutdown handles the shutdown process
@@ -99,21 +129,34 @@ func (s *Server) GracefulShutdown(timeout time.Duration) {
 	// 4. Stop Listener (Stop accepting new TCP connections)
 	// Metrics server still running for monitoring and probes
 	s.listener.Stop()
-
-	// 5. Wait for active connections to drain
-	// Calculate remaining time for connection drain
+	// UDP sessions have no in-flight request semantics to drain; close them
+	// with the listener (clients re-resolve to a live pod and resume).
+	s.udpHandler.Close()
+
+	// 5. Wait for active connections to drain (event-driven)
+	// The listener's connection registry signals the moment the active count
+	// hits zero, so an idle pod finishes here in milliseconds and a busy one
+	// only waits as long as its connections actually live. The timeout is a
+	// deadline for stragglers, not a sleep.
 	// Metrics server remains available for monitoring and probes during this time
 	remainingTime := timeout - k8sWaitTime
 	if remainingTime < 0 {
 		remainingTime = 0
 	}
 
-	if remainingTime > 0 {
-		xlog.Infof("Waiting for active connections to drain (Timeout: %v)...", remainingTime)
+	if active := s.listener.ActiveConns(); active > 0 && remainingTime > 0 {
+		xlog.Infof("Draining %d active connections (deadline: %v)...", active, remainingTime)
 		xlog.Infof("Metrics server remains available for /health and /ready probes during drain")
-		time.Sleep(remainingTime)
-	} else {
-		xlog.Infof("No time remaining for connection drain")
+		drainStart := time.Now()
+		if left := s.listener.Drain(remainingTime); left > 0 {
+			xlog.Warnf("Drain deadline reached with %d connections still open; force-closing stragglers", left)
+			s.listener.CloseActive()
+		} else {
+			xlog.Infof("All connections drained in %v", time.Since(drainStart).Round(time.Millisecond))
+		}
+	} else if active > 0 {
+		xlog.Warnf("No time remaining for connection drain; force-closing %d connections", active)
+		s.listener.CloseActive()
 	}
 
 	// 6. Stop Metrics Server (graceful shutdown) - LAST to close
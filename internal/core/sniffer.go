@@ -2,11 +2,15 @@ package core
 
 import (
 	"bufio"
+	"bytes"
+	"encoding/hex"
 	"io"
 	"net"
 	"strings"
+	"sync"
 	"time"
 
+	"github.com/SkynetNext/unified-access-gateway/internal/proxyproto"
 	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
 )
 
@@ -24,13 +28,48 @@ const (
 type SniffConn struct {
 	net.Conn
 	r *bufio.Reader
+
+	// remoteAddr is the real client address recovered from a PROXY protocol
+	// header, when the fronting LB sent one; nil means the socket peer is
+	// the client.
+	remoteAddr net.Addr
+}
+
+// sniffBufSize sizes the peek buffer. The sniffer itself needs at most a
+// PROXY v2 header plus five magic bytes (~57 bytes); 512 leaves slack for
+// custom magic rules while keeping the per-connection footprint an order of
+// magnitude below bufio's 4KB default — at 100k+ mostly-idle connections
+// that difference alone is hundreds of MB of heap. The shared HTTP engine
+// adds its own request buffering, so HTTP parsing does not depend on this.
+const sniffBufSize = 512
+
+// sniffConnPool recycles SniffConn wrappers together with their bufio
+// buffers; at high accept rates the wrapper and buffer are the dominant
+// per-connection allocations on the dispatch path.
+var sniffConnPool = sync.Pool{
+	New: func() interface{} {
+		return &SniffConn{r: bufio.NewReaderSize(nil, sniffBufSize)}
+	},
 }
 
 func NewSniffConn(c net.Conn) *SniffConn {
-	return &SniffConn{
-		Conn: c,
-		r:    bufio.NewReader(c),
-	}
+	s := sniffConnPool.Get().(*SniffConn)
+	s.Conn = c
+	s.remoteAddr = nil
+	s.r.Reset(c)
+	return s
+}
+
+// Release returns the wrapper and its read buffer to the pool. Only the
+// owner of the connection may call it, exactly once, after the connection is
+// finished; the wrapper must not be touched afterwards. Paths that hand the
+// wrapper to a longer-lived owner (the shared HTTP engine, a TLS session)
+// skip the release and let the GC reclaim it.
+func (s *SniffConn) Release() {
+	s.Conn = nil
+	s.remoteAddr = nil
+	s.r.Reset(nil)
+	sniffConnPool.Put(s)
 }
 
 // Read implements io.Reader, favoring buffer
@@ -38,43 +77,152 @@ func (s *SniffConn) Read(p []byte) (int, error) {
 	return s.r.Read(p)
 }
 
+// RemoteAddr reports the real client address advertised by a PROXY protocol
+// header when one was present, falling back to the socket peer (the LB)
+// otherwise. Security checks and audits therefore always see the client.
+func (s *SniffConn) RemoteAddr() net.Addr {
+	if s.remoteAddr != nil {
+		return s.remoteAddr
+	}
+	return s.Conn.RemoteAddr()
+}
+
 // Unwrap returns the underlying net.Conn for eBPF socket cookie extraction
 // This implements the ebpf.UnwrappableConn interface (implicitly, no import needed)
 func (s *SniffConn) Unwrap() net.Conn {
 	return s.Conn
 }
 
+// WriteBufferedTo flushes any bytes still sitting in the sniff buffer to w
+// and reports how many were written. Once it returns, a caller that owns the
+// read side may bypass the buffered reader and read the underlying
+// connection directly (via Unwrap), e.g. to let io.Copy use splice(2).
+func (s *SniffConn) WriteBufferedTo(w io.Writer) (int64, error) {
+	var total int64
+	for s.r.Buffered() > 0 {
+		peeked, _ := s.r.Peek(s.r.Buffered())
+		n, err := w.Write(peeked)
+		s.r.Discard(n)
+		total += int64(n)
+		if err != nil {
+			return total, err
+		}
+	}
+	return total, nil
+}
+
+// magicRule maps a leading byte sequence to a protocol.
+type magicRule struct {
+	prefix []byte
+	proto  ProtocolType
+}
+
+// magicTable is consulted in order by Sniff. The defaults cover the HTTP
+// methods the gateway dispatches plus the TLS handshake record byte;
+// RegisterMagic lets deployments add custom binary protocol signatures
+// without touching the sniffer itself.
+var magicTable = []magicRule{
+	{[]byte("GET"), ProtocolHTTP},
+	{[]byte("POST"), ProtocolHTTP},
+	{[]byte("PUT "), ProtocolHTTP},
+	{[]byte("DELE"), ProtocolHTTP},
+	{[]byte("HEAD"), ProtocolHTTP},
+	{[]byte("HTTP"), ProtocolHTTP},
+	{[]byte{0x16}, ProtocolTLS}, // TLS Handshake record
+}
+
+// sniffPeekLen is how many leading bytes Sniff inspects; magic prefixes
+// longer than this can never match.
+const sniffPeekLen = 5
+
+// RegisterMagic adds a magic-byte rule to the sniffer table. Rules are
+// matched in registration order after the built-in defaults. Must be called
+// during startup, before the listener begins accepting connections.
+func RegisterMagic(prefix []byte, proto ProtocolType) {
+	magicTable = append(magicTable, magicRule{
+		prefix: append([]byte(nil), prefix...),
+		proto:  proto,
+	})
+}
+
+// RegisterConfiguredMagics feeds the server.protocol_magics config entries
+// into the sniffer table, so an operator can add e.g. a game's handshake
+// signature without rebuilding the binary. Each entry has the form
+// "<hex-prefix>:<protocol>" with protocol one of http, tls or tcp
+// (e.g. "c0ffee:tcp"). Malformed entries are logged and skipped rather than
+// failing startup.
+func RegisterConfiguredMagics(entries []string) {
+	for _, entry := range entries {
+		prefixHex, protoName, ok := strings.Cut(entry, ":")
+		if !ok {
+			xlog.Warnf("Ignoring protocol magic %q: want <hex-prefix>:<protocol>", entry)
+			continue
+		}
+		prefix, err := hex.DecodeString(prefixHex)
+		if err != nil || len(prefix) == 0 {
+			xlog.Warnf("Ignoring protocol magic %q: invalid hex prefix: %v", entry, err)
+			continue
+		}
+		if len(prefix) > sniffPeekLen {
+			xlog.Warnf("Ignoring protocol magic %q: prefix longer than the %d sniffed bytes", entry, sniffPeekLen)
+			continue
+		}
+		var proto ProtocolType
+		switch protoName {
+		case "http":
+			proto = ProtocolHTTP
+		case "tls":
+			proto = ProtocolTLS
+		case "tcp":
+			proto = ProtocolTCP
+		default:
+			xlog.Warnf("Ignoring protocol magic %q: unknown protocol %q", entry, protoName)
+			continue
+		}
+		RegisterMagic(prefix, proto)
+		xlog.Infof("Registered protocol magic %x -> %s", prefix, protoName)
+	}
+}
+
 // Sniff detects protocol type
 func (s *SniffConn) Sniff() ProtocolType {
 	// Set read deadline to prevent hanging on malicious connections
 	s.Conn.SetReadDeadline(time.Now().Add(time.Millisecond * 500))
 	defer s.Conn.SetReadDeadline(time.Time{}) // Clear deadline
 
+	// A fronting LB may prepend a PROXY v2 header; strip it from the peek
+	// buffer (no extra reads or copies) and remember the advertised client
+	// address before detecting the application protocol behind it.
+	if head, err := s.r.Peek(proxyproto.V2HeaderLen); err == nil && proxyproto.IsV2(head) {
+		addr, perr := proxyproto.Parse(s.r)
+		if perr != nil {
+			xlog.Warnf("[SNIFF] %s -> malformed PROXY v2 header: %v", s.Conn.RemoteAddr(), perr)
+			return ProtocolUnknown
+		}
+		if addr != nil {
+			s.remoteAddr = addr
+		}
+	}
+
 	// Peek first 5 bytes
-	bytes, err := s.r.Peek(5)
+	head, err := s.r.Peek(sniffPeekLen)
 	if err != nil && err != io.EOF {
 		return ProtocolUnknown
 	}
 
-	if len(bytes) < 2 {
+	if len(head) < 2 {
 		return ProtocolUnknown
 	}
 
-	// HTTP detection: GET, POST, PUT, DELETE, HEAD...
-	// Check first 3-4 bytes for HTTP methods
-	head := string(bytes)
-	if strings.HasPrefix(head, "GET") || strings.HasPrefix(head, "POST") ||
-		strings.HasPrefix(head, "PUT ") || strings.HasPrefix(head, "DELE") ||
-		strings.HasPrefix(head, "HEAD") || strings.HasPrefix(head, "HTTP") {
-		return ProtocolHTTP
-	}
-
-	// TLS detection: 0x16 (Handshake)
-	if bytes[0] == 0x16 {
-		return ProtocolTLS
+	// Match the peeked bytes against the magic table in place: no string
+	// conversion and no copies, so the sniff hot path allocates nothing.
+	for i := range magicTable {
+		if bytes.HasPrefix(head, magicTable[i].prefix) {
+			return magicTable[i].proto
+		}
 	}
 
 	// Default fallback to TCP (Assuming custom game protocol)
-	xlog.Debugf("[SNIFF] %s -> TCP, peek: hex=%x ascii=%q string=%q", s.Conn.RemoteAddr(), bytes, bytes, head)
+	xlog.Debugf("[SNIFF] %s -> TCP, peek: hex=%x ascii=%q", s.Conn.RemoteAddr(), head, head)
 	return ProtocolTCP
 }
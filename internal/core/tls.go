@@ -0,0 +1,96 @@
+package core
+
+import (
+	"crypto/tls"
+	"time"
+
+	"github.com/SkynetNext/unified-access-gateway/internal/config"
+	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
+)
+
+// tlsHandshakeTimeout bounds the handshake so a client that stalls mid
+// handshake cannot pin a goroutine indefinitely.
+const tlsHandshakeTimeout = 10 * time.Second
+
+// newTLSConfig builds the server-side TLS configuration for termination.
+//
+// Repeat-handshake latency is handled by resumption: session tickets for
+// TLS 1.2 and PSK resumption for TLS 1.3 are on by default, and crypto/tls
+// rotates ticket keys automatically, so a returning client resumes in one
+// round trip without any state shared between handshakes. 0-RTT early data
+// and post-handshake kTLS offload are not supported by crypto/tls; decrypted
+// records flow through the userspace relay, which is why terminated
+// connections are not registered on the sockmap fast path.
+//
+// ALPN advertises HTTP/1.1 only: the shared HTTP engine serves cleartext
+// connections, and a negotiated h2 session would be mis-sniffed after
+// termination.
+func newTLSConfig(cfg *config.TLSConfig) (*tls.Config, error) {
+	cert, err := tls.LoadX509KeyPair(cfg.CertFile, cfg.KeyFile)
+	if err != nil {
+		return nil, err
+	}
+	return &tls.Config{
+		Certificates: []tls.Certificate{cert},
+		MinVersion:   tls.VersionTLS12,
+		NextProtos:   []string{"http/1.1"},
+	}, nil
+}
+
+// handleTLS terminates a sniffed TLS connection and re-dispatches the
+// decrypted stream through the same sniff/dispatch path as cleartext
+// traffic, so HTTP and custom binary protocols work identically over TLS.
+func (l *Listener) handleTLS(sc *SniffConn) {
+	if l.tlsConfig == nil {
+		xlog.Warnf("Conn %s -> TLS but termination not configured, closing", sc.RemoteAddr())
+		sc.Close()
+		return
+	}
+
+	// tls.Server reads the ClientHello through the sniff buffer, so the
+	// peeked handshake bytes are replayed, not lost.
+	tlsConn := tls.Server(sc, l.tlsConfig)
+	tlsConn.SetDeadline(time.Now().Add(tlsHandshakeTimeout))
+	if err := tlsConn.Handshake(); err != nil {
+		xlog.Warnf("TLS handshake with %s failed: %v", sc.RemoteAddr(), err)
+		tlsConn.Close()
+		return
+	}
+	tlsConn.SetDeadline(time.Time{})
+
+	state := tlsConn.ConnectionState()
+	xlog.Debugf("TLS terminated: %s (version=%x, resumed=%v)", sc.RemoteAddr(), state.Version, state.DidResume)
+
+	// Sniff the decrypted stream and dispatch like a cleartext connection.
+	// The outer SniffConn stays referenced by the TLS session, so only the
+	// inner wrapper is recycled here.
+	inner := NewSniffConn(tlsConn)
+	switch inner.Sniff() {
+	case ProtocolHTTP:
+		if l.httpHandler == nil {
+			xlog.Warnf("Conn %s -> TLS/HTTP but handler not configured, closing", sc.RemoteAddr())
+			tlsConn.Close()
+			inner.Release()
+			return
+		}
+		xlog.Debugf("Conn %s -> TLS/HTTP", sc.RemoteAddr())
+		l.httpHandler.ServeConn(inner)
+
+	case ProtocolTCP:
+		if l.tcpHandler == nil {
+			xlog.Warnf("Conn %s -> TLS/TCP but handler not configured, closing", sc.RemoteAddr())
+			tlsConn.Close()
+			inner.Release()
+			return
+		}
+		xlog.Debugf("Conn %s -> TLS/TCP", sc.RemoteAddr())
+		l.tcpHandler.Handle(inner)
+		inner.Release()
+
+	default:
+		// Includes nested TLS; terminating TLS-in-TLS is not supported.
+		xlog.Warnf("Conn %s -> Unknown protocol inside TLS, closing", sc.RemoteAddr())
+		tlsConn.Close()
+		inner.Release()
+	}
+}
@@ -79,16 +79,14 @@ func (c *UpstreamHealthChecker) run() {
 
 // checkAll checks all configured upstreams
 func (c *UpstreamHealthChecker) checkAll() {
-	// Check HTTP backend
-	if c.cfg.Backends.HTTP.TargetURL != "" {
-		healthy := c.checkHTTP(c.cfg.Backends.HTTP.TargetURL)
-		c.updateHealth(c.cfg.Backends.HTTP.TargetURL, healthy)
+	// Check HTTP backends (single target or load-balanced pool)
+	for _, target := range c.cfg.Backends.HTTP.Targets() {
+		c.updateHealth(target, c.checkHTTP(target))
 	}
 
-	// Check TCP backend
-	if c.cfg.Backends.TCP.TargetAddr != "" {
-		healthy := c.checkTCP(c.cfg.Backends.TCP.TargetAddr)
-		c.updateHealth(c.cfg.Backends.TCP.TargetAddr, healthy)
+	// Check TCP backends (single target or load-balanced pool)
+	for _, target := range c.cfg.Backends.TCP.Targets() {
+		c.updateHealth(target, c.checkTCP(target))
 	}
 }
 
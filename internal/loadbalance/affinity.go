@@ -0,0 +1,182 @@
+package loadbalance
+
+import (
+	"sync"
+	"time"
+
+	"github.com/SkynetNext/unified-access-gateway/internal/config"
+)
+
+const (
+	// affinityShards spreads the map across independent locks so the
+	// per-connection lookup never contends globally; 64 shards keep lock
+	// collisions negligible at gateway connection rates.
+	affinityShards = 64
+	// affinityWriteQueue bounds the write-behind queue to Redis. When it is
+	// full new mappings simply are not persisted (local affinity still
+	// works), the same drop-over-block policy the audit pipeline uses.
+	affinityWriteQueue = 4096
+	// affinityReadQueue bounds the read-behind queue rehydrating local
+	// misses from Redis; drop-on-full, like the write queue.
+	affinityReadQueue = 1024
+)
+
+type affinityEntry struct {
+	backend string
+	expires int64 // unix nanos
+}
+
+type affinityShard struct {
+	mu sync.Mutex
+	m  map[string]affinityEntry
+}
+
+type affinityWrite struct {
+	key     string
+	backend string
+}
+
+// AffinityCache remembers which backend served a client so reconnects land
+// on the node that already holds their session state, skipping the cold
+// path (session lookup, cache warm-up) on the backend. Keys are client
+// identity — today the client IP; a token parsed from the first frame can
+// take its place later without changing the cache.
+//
+// Entries expire after the configured TTL and lookups ignore stale entries,
+// so affinity is a routing hint, never a correctness dependency. An optional
+// Redis backing persists mappings across pod restarts. Redis is never
+// touched on the accept path: writes are queued to a single background
+// writer, and a local miss only enqueues a background rehydrate — the miss
+// itself is served immediately (the caller balances normally), so a
+// degraded Redis cannot stall accepts.
+type AffinityCache struct {
+	ttl    time.Duration
+	shards [affinityShards]affinityShard
+	store  *config.RedisStore
+	writes chan affinityWrite
+	reads  chan string
+}
+
+// NewAffinityCache builds a cache with the given TTL, optionally backed by
+// Redis. Returns nil when ttl is zero so callers can treat a nil cache as
+// "affinity disabled".
+func NewAffinityCache(ttl time.Duration, store *config.RedisStore) *AffinityCache {
+	if ttl <= 0 {
+		return nil
+	}
+	c := &AffinityCache{ttl: ttl, store: store}
+	for i := range c.shards {
+		c.shards[i].m = make(map[string]affinityEntry)
+	}
+	if store != nil {
+		c.writes = make(chan affinityWrite, affinityWriteQueue)
+		c.reads = make(chan string, affinityReadQueue)
+		go c.writeLoop()
+		go c.readLoop()
+	}
+	go c.sweepLoop()
+	return c
+}
+
+// shard hashes key with FNV-1a, inlined so the hot-path lookup stays
+// allocation-free.
+func (c *AffinityCache) shard(key string) *affinityShard {
+	h := uint64(14695981039346656037)
+	for i := 0; i < len(key); i++ {
+		h ^= uint64(key[i])
+		h *= 1099511628211
+	}
+	return &c.shards[h%affinityShards]
+}
+
+// Get returns the remembered backend for key. A local miss reports a miss
+// immediately — a synchronous Redis read here would put every brand-new
+// client's accept behind a degraded Redis — and enqueues a background
+// rehydrate instead, so a persisted mapping (pod restart) is back in the
+// local shard for the client's next reconnect.
+func (c *AffinityCache) Get(key string) (string, bool) {
+	s := c.shard(key)
+	now := time.Now().UnixNano()
+	s.mu.Lock()
+	e, ok := s.m[key]
+	if ok && now < e.expires {
+		s.mu.Unlock()
+		return e.backend, true
+	}
+	if ok {
+		delete(s.m, key)
+	}
+	s.mu.Unlock()
+
+	if c.reads != nil {
+		select {
+		case c.reads <- key:
+		default:
+			// Queue full: skip the rehydrate, the mapping is re-learned on
+			// the next successful dial anyway.
+		}
+	}
+	return "", false
+}
+
+// Set remembers key -> backend and refreshes the TTL.
+func (c *AffinityCache) Set(key, backend string) {
+	s := c.shard(key)
+	s.mu.Lock()
+	s.m[key] = affinityEntry{backend: backend, expires: time.Now().UnixNano() + int64(c.ttl)}
+	s.mu.Unlock()
+	if c.writes != nil {
+		select {
+		case c.writes <- affinityWrite{key: key, backend: backend}:
+		default:
+			// Queue full: keep the mapping in local memory only rather than
+			// stall the accept path on Redis.
+		}
+	}
+}
+
+// writeLoop is the single background writer persisting mappings to Redis.
+func (c *AffinityCache) writeLoop() {
+	for w := range c.writes {
+		c.store.AffinitySet(w.key, w.backend, c.ttl)
+	}
+}
+
+// readLoop rehydrates local misses from Redis in the background. A fresh
+// local entry is never clobbered: if a dial completed (and Set ran) while
+// the read was in flight, that newer mapping wins over the persisted one.
+func (c *AffinityCache) readLoop() {
+	for key := range c.reads {
+		backend, ok := c.store.AffinityGet(key)
+		if !ok {
+			continue
+		}
+		s := c.shard(key)
+		now := time.Now().UnixNano()
+		s.mu.Lock()
+		if e, ok := s.m[key]; !ok || now >= e.expires {
+			s.m[key] = affinityEntry{backend: backend, expires: now + int64(c.ttl)}
+		}
+		s.mu.Unlock()
+	}
+}
+
+// sweepLoop evicts expired entries so long-gone clients do not accumulate.
+// Lookups already ignore stale entries; this only bounds memory.
+func (c *AffinityCache) sweepLoop() {
+	ticker := time.NewTicker(c.ttl)
+	defer ticker.Stop()
+	for range ticker.C {
+		now := time.Now().UnixNano()
+		for i := range c.shards {
+			s := &c.shards[i]
+			s.mu.Lock()
+			for k, e := range s.m {
+				if now >= e.expires {
+					delete(s.m, k)
+				}
+			}
+			s.mu.Unlock()
+		}
+	}
+}
@@ -0,0 +1,127 @@
+package loadbalance
+
+import (
+	"math"
+	"time"
+
+	"github.com/SkynetNext/unified-access-gateway/internal/middleware"
+	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
+)
+
+// Passive health parameters. The breaker trips once an endpoint's recent
+// failure rate crosses breakerFailureRate with at least breakerMinSamples
+// observations; recovery is probe-based with exponential backoff, so a dead
+// backend sees one dial per backoff period instead of live traffic until the
+// next active health-check tick.
+const (
+	breakerMinSamples  = 20
+	breakerWindow      = 200 // approximate rolling window: counters reset past this
+	breakerFailureRate = 0.5
+	breakerBaseBackoff = 1 * time.Second
+	breakerMaxBackoff  = 30 * time.Second
+
+	// ewmaAlpha weights the newest latency observation; 0.2 smooths over
+	// roughly the last ten requests.
+	ewmaAlpha = 0.2
+)
+
+// Report feeds a dial/request outcome back into the picker's passive health
+// state. success latency observations also update the endpoint's latency
+// EWMA (exported as gateway_upstream_latency_ewma_seconds for weighting).
+// Unknown addresses are ignored.
+func (p *Picker) Report(addr string, success bool, latency time.Duration) {
+	ep := p.state.Load().byAddr[addr]
+	if ep == nil {
+		return
+	}
+
+	if success {
+		ewma := ep.observeLatency(latency)
+		middleware.SetUpstreamLatencyEWMA(addr, ewma)
+
+		// A success while tripped is the recovery probe (the breaker admits
+		// no other traffic; a straggler from before the trip closing the
+		// circuit early is harmless). Reset the window and the backoff.
+		if ep.tripped.Load() && ep.probing.CompareAndSwap(true, false) {
+			ep.failures.Store(0)
+			ep.samples.Store(0)
+			ep.backoffExp.Store(0)
+			ep.tripped.Store(false)
+			middleware.SetUpstreamHealth(addr, true)
+			xlog.Infof("Upstream %s recovered (probe succeeded), circuit closed", addr)
+		}
+		ep.countSample(false)
+		return
+	}
+
+	// Failed probe: keep the circuit open and double the backoff.
+	if ep.tripped.Load() && ep.probing.CompareAndSwap(true, false) {
+		ep.reopen(addr)
+		return
+	}
+
+	ep.countSample(true)
+	f := ep.failures.Load()
+	s := ep.samples.Load()
+	if s >= breakerMinSamples && float64(f) >= breakerFailureRate*float64(s) &&
+		ep.tripped.CompareAndSwap(false, true) {
+		ep.reopen(addr)
+	}
+}
+
+// Ewma returns the endpoint's smoothed latency in seconds (0 until the first
+// observation), for future latency-weighted selection.
+func (p *Picker) Ewma(addr string) float64 {
+	ep := p.state.Load().byAddr[addr]
+	if ep == nil {
+		return 0
+	}
+	return math.Float64frombits(ep.ewmaBits.Load())
+}
+
+// countSample records one outcome, resetting the counters once the window is
+// exceeded so old traffic stops diluting the failure rate. The reset races
+// with concurrent reporters, which only makes the window size approximate.
+func (ep *endpoint) countSample(failed bool) {
+	if failed {
+		ep.failures.Add(1)
+	}
+	if ep.samples.Add(1) > breakerWindow {
+		ep.samples.Store(0)
+		ep.failures.Store(0)
+	}
+}
+
+// reopen (re)opens the circuit with the next exponential backoff step and
+// schedules the recovery probe.
+func (ep *endpoint) reopen(addr string) {
+	exp := ep.backoffExp.Load()
+	backoff := breakerBaseBackoff << exp
+	if backoff >= breakerMaxBackoff {
+		backoff = breakerMaxBackoff
+	} else {
+		ep.backoffExp.Store(exp + 1)
+	}
+	ep.openUntil.Store(time.Now().Add(backoff).UnixNano())
+	ep.failures.Store(0)
+	ep.samples.Store(0)
+	middleware.SetUpstreamHealth(addr, false)
+	xlog.Warnf("Upstream %s circuit opened (next probe in %v)", addr, backoff)
+}
+
+// observeLatency folds one latency sample into the endpoint's EWMA and
+// returns the new value in seconds. Lock-free via CAS on the float bits.
+func (ep *endpoint) observeLatency(d time.Duration) float64 {
+	x := d.Seconds()
+	for {
+		oldBits := ep.ewmaBits.Load()
+		next := x
+		if oldBits != 0 {
+			cur := math.Float64frombits(oldBits)
+			next = cur + ewmaAlpha*(x-cur)
+		}
+		if ep.ewmaBits.CompareAndSwap(oldBits, math.Float64bits(next)) {
+			return next
+		}
+	}
+}
@@ -0,0 +1,176 @@
+// Package loadbalance provides backend endpoint selection for the proxy
+// handlers. Selection state is pure atomics so pickers can sit on the
+// per-connection and per-request hot paths without locking.
+package loadbalance
+
+import (
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// endpoint tracks in-flight load and passive health for one backend address.
+type endpoint struct {
+	addr   string
+	active atomic.Int64
+
+	// Circuit breaker state, fed by Picker.Report. While tripped the
+	// endpoint only receives the scheduled recovery probe.
+	failures   atomic.Uint64
+	samples    atomic.Uint64
+	tripped    atomic.Bool
+	openUntil  atomic.Int64 // unix nanos; when the next probe is due
+	backoffExp atomic.Uint32
+	probing    atomic.Bool
+
+	// Smoothed observed latency (float64 bits), see observeLatency.
+	ewmaBits atomic.Uint64
+}
+
+// pickerState is one immutable endpoint set. The picker swaps whole states
+// atomically on discovery updates, so the hot-path readers stay lock-free.
+type pickerState struct {
+	endpoints []*endpoint
+	byAddr    map[string]*endpoint
+}
+
+// Picker selects among backend endpoints using least-connections, with a
+// rotating scan start so equally loaded endpoints are used round-robin.
+// Endpoints whose circuit breaker is open are skipped; see health.go.
+// The endpoint set can be replaced at runtime via UpdateEndpoints (service
+// discovery); selection always works on one consistent snapshot.
+type Picker struct {
+	state    atomic.Pointer[pickerState]
+	next     atomic.Uint64
+	updateMu sync.Mutex // serializes UpdateEndpoints
+}
+
+// newPickerState builds an endpoint set over addrs, reusing endpoints from
+// prev (nil-safe) so in-flight counts and breaker state survive updates.
+func newPickerState(addrs []string, prev *pickerState) *pickerState {
+	eps := make([]*endpoint, 0, len(addrs))
+	byAddr := make(map[string]*endpoint, len(addrs))
+	for _, addr := range addrs {
+		if addr == "" || byAddr[addr] != nil {
+			continue
+		}
+		var ep *endpoint
+		if prev != nil {
+			ep = prev.byAddr[addr]
+		}
+		if ep == nil {
+			ep = &endpoint{addr: addr}
+		}
+		eps = append(eps, ep)
+		byAddr[addr] = ep
+	}
+	return &pickerState{endpoints: eps, byAddr: byAddr}
+}
+
+// NewPicker builds a picker over addrs. Returns nil if no usable address is
+// given, so callers can treat a nil picker as "backend not configured".
+func NewPicker(addrs []string) *Picker {
+	s := newPickerState(addrs, nil)
+	if len(s.endpoints) == 0 {
+		return nil
+	}
+	p := &Picker{}
+	p.state.Store(s)
+	return p
+}
+
+// UpdateEndpoints replaces the endpoint set, keeping in-flight counts and
+// breaker state for addresses present in both sets. Sessions already holding
+// a release func on a removed endpoint keep it; the orphaned endpoint just
+// stops receiving new picks. An empty update is ignored — a transient
+// resolution failure or a rolling restart emptying the endpoint list must
+// not wipe the backend set — and so is an update that changes nothing.
+// Reports whether the set actually changed.
+func (p *Picker) UpdateEndpoints(addrs []string) bool {
+	p.updateMu.Lock()
+	defer p.updateMu.Unlock()
+
+	cur := p.state.Load()
+	next := newPickerState(addrs, cur)
+	if len(next.endpoints) == 0 {
+		return false
+	}
+	if len(next.endpoints) == len(cur.endpoints) {
+		same := true
+		for _, ep := range next.endpoints {
+			if cur.byAddr[ep.addr] != ep {
+				same = false
+				break
+			}
+		}
+		if same {
+			return false
+		}
+	}
+	p.state.Store(next)
+	return true
+}
+
+// Pick returns the least-loaded healthy endpoint address and a release func
+// the caller must invoke when the connection or request finishes. A tripped
+// endpoint whose backoff has expired claims the request as its recovery
+// probe. If every endpoint is tripped, Pick falls back to least-connections
+// over all of them rather than failing outright (fail static).
+func (p *Picker) Pick() (string, func()) {
+	eps := p.state.Load().endpoints
+	now := time.Now().UnixNano()
+	start := int(p.next.Add(1))
+	var best *endpoint
+	var bestActive int64
+	for i := 0; i < len(eps); i++ {
+		ep := eps[(start+i)%len(eps)]
+		if ep.tripped.Load() {
+			// A due probe takes the request immediately; claiming it here
+			// and not sending it would leave the breaker stuck open.
+			if now >= ep.openUntil.Load() && ep.probing.CompareAndSwap(false, true) {
+				ep.active.Add(1)
+				return ep.addr, func() { ep.active.Add(-1) }
+			}
+			continue
+		}
+		if a := ep.active.Load(); best == nil || a < bestActive {
+			best, bestActive = ep, a
+		}
+	}
+	if best == nil {
+		best = eps[start%len(eps)]
+		bestActive = best.active.Load()
+		for i := 1; i < len(eps); i++ {
+			ep := eps[(start+i)%len(eps)]
+			if a := ep.active.Load(); a < bestActive {
+				best, bestActive = ep, a
+			}
+		}
+	}
+	best.active.Add(1)
+	return best.addr, func() { best.active.Add(-1) }
+}
+
+// PickAddr claims a connection slot on a specific endpoint, used by the
+// session-affinity fast path. It refuses (returns false) when the address is
+// not a configured endpoint or its circuit breaker is open, so affinity can
+// never pin clients to a dead or removed backend — callers fall back to
+// Pick. On success the caller must invoke the release func when done.
+func (p *Picker) PickAddr(addr string) (func(), bool) {
+	ep, ok := p.state.Load().byAddr[addr]
+	if !ok || ep.tripped.Load() {
+		return nil, false
+	}
+	ep.active.Add(1)
+	return func() { ep.active.Add(-1) }, true
+}
+
+// Endpoints returns the current backend addresses.
+func (p *Picker) Endpoints() []string {
+	eps := p.state.Load().endpoints
+	out := make([]string, len(eps))
+	for i, ep := range eps {
+		out[i] = ep.addr
+	}
+	return out
+}
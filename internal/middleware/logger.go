@@ -1,34 +1,69 @@
 package middleware
 
 import (
-	"encoding/json"
+	"strconv"
+	"sync"
 	"time"
-	
+
 	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
 )
 
-// AccessLog defines the structure of access logs
+// AccessLog defines the structure of access logs.
+// Entries are pooled: obtain one with GetAccessLog, hand it to Log, and the
+// consumer returns it to the pool after flushing. Callers must not retain an
+// entry after passing it to Log.
 type AccessLog struct {
-	Timestamp   time.Time `json:"ts"`
-	ClientIP    string    `json:"client_ip"`
-	Protocol    string    `json:"protocol"` // HTTP, TCP
-	Method      string    `json:"method,omitempty"` // HTTP only
-	Path        string    `json:"path,omitempty"`   // HTTP only
-	DurationMs  int64     `json:"duration_ms"`
-	Status      int       `json:"status"`
-	BytesIn     int64     `json:"bytes_in"`
-	BytesOut    int64     `json:"bytes_out"`
+	Timestamp  time.Time `json:"ts"`
+	ClientIP   string    `json:"client_ip"`
+	Protocol   string    `json:"protocol"`         // HTTP, TCP
+	Method     string    `json:"method,omitempty"` // HTTP only
+	Path       string    `json:"path,omitempty"`   // HTTP only
+	DurationMs int64     `json:"duration_ms"`
+	Status     int       `json:"status"`
+	BytesIn    int64     `json:"bytes_in"`
+	BytesOut   int64     `json:"bytes_out"`
+}
+
+// accessLogPool recycles entries between producers and the flush path so
+// steady-state logging performs no per-entry heap allocation.
+var accessLogPool = sync.Pool{
+	New: func() interface{} { return new(AccessLog) },
+}
+
+// GetAccessLog returns a zeroed entry from the pool.
+func GetAccessLog() *AccessLog {
+	entry := accessLogPool.Get().(*AccessLog)
+	*entry = AccessLog{}
+	return entry
 }
 
 type Logger struct {
-	logChan chan *AccessLog
+	logChan       chan *AccessLog
+	batchSize     int
+	flushInterval time.Duration
+
+	// encodeBuf is reused across flushes; only the consumer goroutine
+	// touches it, so no locking is needed.
+	encodeBuf []byte
 }
 
 var Instance *Logger
 
-func InitLogger(bufferSize int) {
+// InitLogger starts the background consumer. batchSize and flushInterval are
+// the size/time flush triggers; zero values keep the defaults (100 entries,
+// 1 second).
+func InitLogger(bufferSize, batchSize int, flushInterval time.Duration) {
+	if batchSize <= 0 {
+		batchSize = 100
+	}
+	if flushInterval <= 0 {
+		flushInterval = time.Second
+	}
 	Instance = &Logger{
-		logChan: make(chan *AccessLog, bufferSize),
+		logChan:       make(chan *AccessLog, bufferSize),
+		batchSize:     batchSize,
+		flushInterval: flushInterval,
+		encodeBuf:     make([]byte, 0, 64<<10),
 	}
 	go Instance.startConsumer()
 }
@@ -38,21 +73,22 @@ func (l *Logger) Log(entry *AccessLog) {
 	case l.logChan <- entry:
 	default:
 		// Buffer full, drop log to prevent blocking main flow
+		accessLogPool.Put(entry)
 		xlog.Warnf("Access log buffer full, dropping log")
 	}
 }
 
 func (l *Logger) startConsumer() {
-	// Simulate batch sending to Kafka
+	// Batch sending to Kafka
 	// In production, use sarama.AsyncProducer
-	batch := make([]*AccessLog, 0, 100)
-	ticker := time.NewTicker(1 * time.Second)
-	
+	batch := make([]*AccessLog, 0, l.batchSize)
+	ticker := time.NewTicker(l.flushInterval)
+
 	for {
 		select {
 		case entry := <-l.logChan:
 			batch = append(batch, entry)
-			if len(batch) >= 100 {
+			if len(batch) >= l.batchSize {
 				l.flushToKafka(batch)
 				batch = batch[:0]
 			}
@@ -65,14 +101,54 @@ func (l *Logger) startConsumer() {
 	}
 }
 
+// flushToKafka serializes the whole batch into the reused encode buffer as
+// newline-delimited JSON (one producer payload per flush) and releases the
+// entries back to the pool. Encoding is append-based, so once the buffer has
+// grown to its working size a flush allocates nothing.
 func (l *Logger) flushToKafka(logs []*AccessLog) {
+	buf := l.encodeBuf[:0]
+	for _, entry := range logs {
+		buf = appendAccessLog(buf, entry)
+		buf = append(buf, '\n')
+	}
+	l.encodeBuf = buf
+
 	// Mock: Print to console, actually produce to Kafka Topic
-	xlog.Infof("Flushing %d access logs to Kafka...", len(logs))
-	for _, log := range logs {
-		data, _ := json.Marshal(log)
-		// In real scenario: producer.Input() <- &sarama.ProducerMessage{...}
-		// Print only the first log for demo
-		xlog.Debugf("Kafka Log Payload: %s", string(data))
-		break 
+	// In real scenario the buffer is handed to the producer as one batched
+	// message: producer.Input() <- &sarama.ProducerMessage{Value: buf}
+	xlog.Infof("Flushing %d access logs to Kafka (%d bytes)...", len(logs), len(buf))
+	xlog.Debugf("Kafka Log Payload: %s", buf)
+
+	for _, entry := range logs {
+		accessLogPool.Put(entry)
+	}
+}
+
+// appendAccessLog encodes one entry without reflection or intermediate
+// allocations. Field names and omitempty behavior match the struct tags.
+func appendAccessLog(buf []byte, e *AccessLog) []byte {
+	buf = append(buf, `{"ts":"`...)
+	buf = e.Timestamp.AppendFormat(buf, time.RFC3339Nano)
+	buf = append(buf, `","client_ip":`...)
+	buf = strconv.AppendQuote(buf, e.ClientIP)
+	buf = append(buf, `,"protocol":`...)
+	buf = strconv.AppendQuote(buf, e.Protocol)
+	if e.Method != "" {
+		buf = append(buf, `,"method":`...)
+		buf = strconv.AppendQuote(buf, e.Method)
+	}
+	if e.Path != "" {
+		buf = append(buf, `,"path":`...)
+		buf = strconv.AppendQuote(buf, e.Path)
 	}
+	buf = append(buf, `,"duration_ms":`...)
+	buf = strconv.AppendInt(buf, e.DurationMs, 10)
+	buf = append(buf, `,"status":`...)
+	buf = strconv.AppendInt(buf, int64(e.Status), 10)
+	buf = append(buf, `,"bytes_in":`...)
+	buf = strconv.AppendInt(buf, e.BytesIn, 10)
+	buf = append(buf, `,"bytes_out":`...)
+	buf = strconv.AppendInt(buf, e.BytesOut, 10)
+	buf = append(buf, '}')
+	return buf
 }
@@ -1,6 +1,8 @@
 package middleware
 
 import (
+	"sync"
+
 	"github.com/prometheus/client_golang/prometheus"
 	"github.com/prometheus/client_golang/prometheus/promauto"
 )
@@ -32,51 +34,42 @@ var (
 		[]string{"protocol", "method", "upstream"},
 	)
 
-	// RequestBytes: Request/Response bytes (Counter)
-	// Labels: protocol, direction (in/out)
-	RequestBytes = promauto.NewCounterVec(
-		prometheus.CounterOpts{
-			Name: "gateway_request_bytes_total",
-			Help: "Total bytes transferred (request + response)",
-		},
-		[]string{"protocol", "direction"},
-	)
-
 	// ============================================================================
 	// Connection Metrics
 	// ============================================================================
+	// gateway_active_connections, gateway_connections_total,
+	// gateway_request_bytes_total and gateway_connection_duration_seconds
+	// live in the sharded frontend (metrics_sharded.go): they fire on every
+	// connection event, so they are recorded into cacheline-padded shards
+	// and materialized as Prometheus metrics only at scrape time.
 
-	// ActiveConnections: Current active connections (Gauge)
-	// Labels: protocol
-	ActiveConnections = promauto.NewGaugeVec(
-		prometheus.GaugeOpts{
-			Name: "gateway_active_connections",
-			Help: "Current number of active connections",
-		},
-		[]string{"protocol"},
-	)
-
-	// ConnectionsTotal: Total connections accepted (Counter)
-	// Labels: protocol
-	ConnectionsTotal = promauto.NewCounterVec(
-		prometheus.CounterOpts{
-			Name: "gateway_connections_total",
-			Help: "Total number of connections accepted",
-		},
-		[]string{"protocol"},
-	)
+	// ============================================================================
+	// Accept-to-Dispatch Pipeline Metrics
+	// ============================================================================
 
-	// ConnectionDuration: Connection lifetime (Histogram)
-	// Labels: protocol
-	ConnectionDuration = promauto.NewHistogramVec(
+	// PipelineStageDuration: Latency of each stage between accept and
+	// dispatch (Histogram)
+	// Labels: stage (accept_to_sniff, sniff, security_check, dispatch_to_backend)
+	// Buckets reach down to 10µs: the interesting regressions here are
+	// queueing and sniff stalls far below the request-latency buckets.
+	PipelineStageDuration = promauto.NewHistogramVec(
 		prometheus.HistogramOpts{
-			Name:    "gateway_connection_duration_seconds",
-			Help:    "Connection lifetime in seconds",
-			Buckets: []float64{1, 5, 10, 30, 60, 300, 600, 1800, 3600},
+			Name:    "gateway_pipeline_stage_duration_seconds",
+			Help:    "Accept-to-dispatch pipeline stage latency in seconds",
+			Buckets: []float64{0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.025, 0.1, 0.5, 1},
 		},
-		[]string{"protocol"},
+		[]string{"stage"},
 	)
 
+	// Per-stage observers bound once at init. Observing through these skips
+	// the label hashing and vec lookup entirely, leaving one atomic add per
+	// observation, so the instrumentation itself cannot serialize the accept
+	// path across dispatch workers.
+	stageAcceptToSniff     = PipelineStageDuration.WithLabelValues("accept_to_sniff")
+	stageSniff             = PipelineStageDuration.WithLabelValues("sniff")
+	stageSecurityCheck     = PipelineStageDuration.WithLabelValues("security_check")
+	stageDispatchToBackend = PipelineStageDuration.WithLabelValues("dispatch_to_backend")
+
 	// ============================================================================
 	// Upstream/Backend Metrics
 	// ============================================================================
@@ -112,6 +105,16 @@ var (
 		[]string{"upstream"},
 	)
 
+	// UpstreamLatencyEWMA: Smoothed per-endpoint latency (Gauge)
+	// Labels: upstream
+	UpstreamLatencyEWMA = promauto.NewGaugeVec(
+		prometheus.GaugeOpts{
+			Name: "gateway_upstream_latency_ewma_seconds",
+			Help: "Exponentially weighted moving average of upstream latency",
+		},
+		[]string{"upstream"},
+	)
+
 	// ============================================================================
 	// Security & Policy Metrics
 	// ============================================================================
@@ -135,22 +138,124 @@ var (
 		},
 		[]string{"limit_name"},
 	)
+
+	// ============================================================================
+	// eBPF Fast-Path Metrics
+	// ============================================================================
+
+	// SockmapEntries: Sockets currently registered in the eBPF sock_pair_map (Gauge)
+	SockmapEntries = promauto.NewGauge(
+		prometheus.GaugeOpts{
+			Name: "gateway_sockmap_entries",
+			Help: "Sockets currently registered for eBPF sockmap redirection",
+		},
+	)
+
+	// SockmapRegisterFailuresTotal: Socket pairs that failed sockmap registration (Counter)
+	SockmapRegisterFailuresTotal = promauto.NewCounter(
+		prometheus.CounterOpts{
+			Name: "gateway_sockmap_register_failures_total",
+			Help: "Socket pairs that could not be registered in the eBPF sockmap (e.g. map full); their traffic stays on the userspace relay",
+		},
+	)
+
+	// AuditDroppedTotal: Audit entries dropped because the queue was full (Counter)
+	AuditDroppedTotal = promauto.NewCounter(
+		prometheus.CounterOpts{
+			Name: "gateway_audit_dropped_total",
+			Help: "Total audit log entries dropped due to a full audit queue",
+		},
+	)
+)
+
+// Per-upstream series caches. The upstream label is dynamic but drawn from
+// the small fixed backend list in config, so each upstream's series are
+// bound once on first sight and steady-state recording is a lock-free map
+// read plus the series' own atomic — no label hashing per event.
+var (
+	tcpSeriesCache sync.Map // upstream -> *requestSeries
+	udpSeriesCache sync.Map // upstream -> *requestSeries
+	upstreamCache  sync.Map // upstream -> *upstreamSeries
 )
 
+// requestSeries holds the pre-bound request count/duration series for one
+// upstream under one protocol.
+type requestSeries struct {
+	requests prometheus.Counter
+	duration prometheus.Observer
+}
+
+func requestSeriesFor(cache *sync.Map, protocol, upstream string) *requestSeries {
+	if v, ok := cache.Load(upstream); ok {
+		return v.(*requestSeries)
+	}
+	s := &requestSeries{
+		requests: RequestsTotal.WithLabelValues(protocol, protocol, "success", upstream),
+		duration: RequestDuration.WithLabelValues(protocol, protocol, upstream),
+	}
+	v, _ := cache.LoadOrStore(upstream, s)
+	return v.(*requestSeries)
+}
+
+// upstreamSeries holds the pre-bound upstream-request series for one
+// upstream, one counter per known outcome.
+type upstreamSeries struct {
+	success  prometheus.Counter
+	failed   prometheus.Counter
+	duration prometheus.Observer
+}
+
+func upstreamSeriesFor(upstream string) *upstreamSeries {
+	if v, ok := upstreamCache.Load(upstream); ok {
+		return v.(*upstreamSeries)
+	}
+	s := &upstreamSeries{
+		success:  UpstreamRequestsTotal.WithLabelValues(upstream, "success"),
+		failed:   UpstreamRequestsTotal.WithLabelValues(upstream, "connection_failed"),
+		duration: UpstreamDuration.WithLabelValues(upstream),
+	}
+	v, _ := upstreamCache.LoadOrStore(upstream, s)
+	return v.(*upstreamSeries)
+}
+
 // RecordHTTPMetrics records comprehensive HTTP request metrics
 func RecordHTTPMetrics(method, status, upstream string, durationSeconds float64, bytesIn, bytesOut int64) {
+	// method and status stay dynamic lookups: their cardinality is open and
+	// the HTTP path already pays full request processing per event.
 	RequestsTotal.WithLabelValues("http", method, status, upstream).Inc()
 	RequestDuration.WithLabelValues("http", method, upstream).Observe(durationSeconds)
-	RequestBytes.WithLabelValues("http", "in").Add(float64(bytesIn))
-	RequestBytes.WithLabelValues("http", "out").Add(float64(bytesOut))
+	addRequestBytes(protoHTTP, bytesIn, bytesOut)
 }
 
 // RecordTCPMetrics records TCP connection metrics
 func RecordTCPMetrics(upstream string, durationSeconds float64, bytesIn, bytesOut int64) {
-	RequestsTotal.WithLabelValues("tcp", "tcp", "success", upstream).Inc()
-	RequestDuration.WithLabelValues("tcp", "tcp", upstream).Observe(durationSeconds)
-	RequestBytes.WithLabelValues("tcp", "in").Add(float64(bytesIn))
-	RequestBytes.WithLabelValues("tcp", "out").Add(float64(bytesOut))
+	s := requestSeriesFor(&tcpSeriesCache, "tcp", upstream)
+	s.requests.Inc()
+	s.duration.Observe(durationSeconds)
+	addRequestBytes(protoTCP, bytesIn, bytesOut)
+}
+
+// Pipeline stage observers. Callers time the stage themselves and hand in
+// seconds; each call is a single pre-bound histogram observation.
+func ObserveAcceptToSniff(seconds float64)     { stageAcceptToSniff.Observe(seconds) }
+func ObserveSniff(seconds float64)             { stageSniff.Observe(seconds) }
+func ObserveSecurityCheck(seconds float64)     { stageSecurityCheck.Observe(seconds) }
+func ObserveDispatchToBackend(seconds float64) { stageDispatchToBackend.Observe(seconds) }
+
+// RecordUDPMetrics records UDP session metrics (one observation per session,
+// emitted when the session is torn down)
+func RecordUDPMetrics(upstream string, durationSeconds float64, bytesIn, bytesOut int64) {
+	s := requestSeriesFor(&udpSeriesCache, "udp", upstream)
+	s.requests.Inc()
+	s.duration.Observe(durationSeconds)
+	addRequestBytes(protoUDP, bytesIn, bytesOut)
+}
+
+// AddTCPFastPathBytes accounts bytes moved by the eBPF sockmap fast path.
+// Kernel-redirected traffic bypasses the userspace relay entirely, so it is
+// invisible to RecordTCPMetrics and must be fed in from the sockmap stats map.
+func AddTCPFastPathBytes(bytesIn, bytesOut int64) {
+	addRequestBytes(protoTCP, bytesIn, bytesOut)
 }
 
 // RecordMetrics is kept for backward compatibility
@@ -160,23 +265,32 @@ func RecordMetrics(protocol string, status string, durationSeconds float64) {
 }
 
 func IncActiveConnections(protocol string) {
-	ActiveConnections.WithLabelValues(protocol).Inc()
-	ConnectionsTotal.WithLabelValues(protocol).Inc()
+	p := protoIndex(protocol)
+	activeConns[p].add(1)
+	connsTotal[p].add(1)
 }
 
 func DecActiveConnections(protocol string) {
-	ActiveConnections.WithLabelValues(protocol).Dec()
+	activeConns[protoIndex(protocol)].add(-1)
 }
 
 // RecordConnectionDuration records connection lifetime
 func RecordConnectionDuration(protocol string, durationSeconds float64) {
-	ConnectionDuration.WithLabelValues(protocol).Observe(durationSeconds)
+	connDurations[protoIndex(protocol)].observe(durationSeconds)
 }
 
 // RecordUpstreamRequest records upstream request metrics
 func RecordUpstreamRequest(upstream, status string, durationSeconds float64) {
-	UpstreamRequestsTotal.WithLabelValues(upstream, status).Inc()
-	UpstreamDuration.WithLabelValues(upstream).Observe(durationSeconds)
+	s := upstreamSeriesFor(upstream)
+	switch status {
+	case "success":
+		s.success.Inc()
+	case "connection_failed":
+		s.failed.Inc()
+	default:
+		UpstreamRequestsTotal.WithLabelValues(upstream, status).Inc()
+	}
+	s.duration.Observe(durationSeconds)
 }
 
 // SetUpstreamHealth sets upstream health status
@@ -188,11 +302,32 @@ func SetUpstreamHealth(upstream string, healthy bool) {
 	UpstreamHealth.WithLabelValues(upstream).Set(health)
 }
 
+// SetUpstreamLatencyEWMA reports the smoothed latency for an upstream
+func SetUpstreamLatencyEWMA(upstream string, seconds float64) {
+	UpstreamLatencyEWMA.WithLabelValues(upstream).Set(seconds)
+}
+
 // RecordSecurityBlock records a security block event
 func RecordSecurityBlock(reason string) {
 	SecurityBlocksTotal.WithLabelValues(reason).Inc()
 }
 
+// SetSockmapEntries reports current sockmap occupancy; against the configured
+// map capacity this shows fast-path coverage and headroom
+func SetSockmapEntries(n int) {
+	SockmapEntries.Set(float64(n))
+}
+
+// AddSockmapRegisterFailures records socket pairs that missed the kernel fast path
+func AddSockmapRegisterFailures(n int) {
+	SockmapRegisterFailuresTotal.Add(float64(n))
+}
+
+// RecordAuditDrop records an audit entry dropped under backpressure
+func RecordAuditDrop() {
+	AuditDroppedTotal.Inc()
+}
+
 // RecordRateLimitHit records a rate limit hit
 func RecordRateLimitHit(limitName string) {
 	RateLimitHits.WithLabelValues(limitName).Inc()
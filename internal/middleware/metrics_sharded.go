@@ -0,0 +1,201 @@
+package middleware
+
+import (
+	"sync/atomic"
+	"unsafe"
+
+	"github.com/prometheus/client_golang/prometheus"
+)
+
+// Sharded hot-path metrics frontend.
+//
+// Every connection event used to land on a Prometheus collector directly: a
+// WithLabelValues hash-and-lookup plus an atomic on one globally shared
+// cacheline per metric. At high accept rates those shared cachelines bounce
+// between every core running a dispatch worker and the instrumentation
+// itself becomes a serialization point. For the per-connection metrics with
+// small fixed label sets (protocol, direction) the frontend below keeps
+// cacheline-padded shards of plain atomics that goroutines spread across,
+// and a custom collector folds the shards into ordinary Prometheus metrics
+// only at scrape time — a few times a minute instead of per event. The
+// scrape output (names, labels, buckets) is identical to the promauto
+// collectors this replaces.
+
+const (
+	// counterShards trades memory (one cacheline per shard) for update
+	// independence; 64 comfortably covers the core counts this gateway
+	// runs on.
+	counterShards = 64
+
+	protoTCP   = 0
+	protoHTTP  = 1
+	protoUDP   = 2
+	protoCount = 3
+)
+
+var protoNames = [protoCount]string{"tcp", "http", "udp"}
+
+// protoIndex maps the protocol label used on the connection path to its
+// fixed slot. The connection path only ever passes the three known
+// protocols; anything else folds into the tcp slot rather than growing the
+// set dynamically.
+func protoIndex(protocol string) int {
+	switch protocol {
+	case "http":
+		return protoHTTP
+	case "udp":
+		return protoUDP
+	default:
+		return protoTCP
+	}
+}
+
+// shardIndex picks a shard for the calling goroutine. Go exposes no CPU or
+// goroutine identifier, so the address of a stack variable stands in: every
+// goroutine has its own stack, which gives the per-connection goroutines
+// stable, well-spread indexes for the cost of a shift and a multiply. The
+// final shift keeps the top 6 bits (64 = counterShards).
+func shardIndex() int {
+	var marker byte
+	h := uint64(uintptr(unsafe.Pointer(&marker)) >> 10)
+	return int((h * 0x9E3779B97F4A7C15) >> 58)
+}
+
+// paddedCount is one shard of a counter, padded out to a full cacheline so
+// neighbouring shards never share one.
+type paddedCount struct {
+	n atomic.Int64
+	_ [56]byte
+}
+
+// shardedCount is an int64 counter (or gauge, when also decremented) whose
+// updates spread across cacheline-padded shards. Individual shards of a
+// gauge may go negative (inc and dec can land on different shards); only
+// the total is meaningful.
+type shardedCount struct {
+	shards [counterShards]paddedCount
+}
+
+func (c *shardedCount) add(delta int64) { c.shards[shardIndex()].n.Add(delta) }
+
+func (c *shardedCount) total() int64 {
+	var sum int64
+	for i := range c.shards {
+		sum += c.shards[i].n.Load()
+	}
+	return sum
+}
+
+// connDurationBuckets mirrors the buckets of the promauto histogram this
+// frontend replaced; the scrape output stays bit-identical for dashboards.
+var connDurationBuckets = [...]float64{1, 5, 10, 30, 60, 300, 600, 1800, 3600}
+
+// histShard is one shard of a sharded histogram: per-bucket counts plus the
+// total count and sum. The sum is kept in integer microseconds so updating
+// it is a plain atomic add rather than a CAS loop on float bits; for
+// connection lifetimes that precision is far below bucket resolution.
+type histShard struct {
+	counts [len(connDurationBuckets)]atomic.Int64
+	count  atomic.Int64
+	sumUs  atomic.Int64
+	_      [40]byte // pad the 88-byte payload to cacheline multiples
+}
+
+type shardedHistogram struct {
+	shards [counterShards]histShard
+}
+
+func (h *shardedHistogram) observe(seconds float64) {
+	s := &h.shards[shardIndex()]
+	for i, ub := range connDurationBuckets {
+		if seconds <= ub {
+			s.counts[i].Add(1)
+			break
+		}
+	}
+	s.count.Add(1)
+	s.sumUs.Add(int64(seconds * 1e6))
+}
+
+// snapshot folds the shards into the cumulative form MustNewConstHistogram
+// expects. Observations above the largest bucket appear only in count/sum,
+// exactly as the +Inf bucket behaves.
+func (h *shardedHistogram) snapshot() (count uint64, sum float64, buckets map[float64]uint64) {
+	var perBucket [len(connDurationBuckets)]int64
+	var total, sumUs int64
+	for i := range h.shards {
+		s := &h.shards[i]
+		for j := range perBucket {
+			perBucket[j] += s.counts[j].Load()
+		}
+		total += s.count.Load()
+		sumUs += s.sumUs.Load()
+	}
+	buckets = make(map[float64]uint64, len(connDurationBuckets))
+	var cum int64
+	for j, ub := range connDurationBuckets {
+		cum += perBucket[j]
+		buckets[ub] = uint64(cum)
+	}
+	return uint64(total), float64(sumUs) / 1e6, buckets
+}
+
+// Frontend state behind IncActiveConnections / DecActiveConnections,
+// AddTCPFastPathBytes, RecordConnectionDuration and the byte accounting in
+// the Record*Metrics functions.
+var (
+	activeConns     [protoCount]shardedCount
+	connsTotal      [protoCount]shardedCount
+	requestBytesIn  [protoCount]shardedCount
+	requestBytesOut [protoCount]shardedCount
+	connDurations   [protoCount]shardedHistogram
+)
+
+func addRequestBytes(proto int, in, out int64) {
+	requestBytesIn[proto].add(in)
+	requestBytesOut[proto].add(out)
+}
+
+// Descriptors for the scrape-time view; names, help strings and labels
+// match the promauto collectors the frontend replaced.
+var (
+	activeConnsDesc = prometheus.NewDesc("gateway_active_connections",
+		"Current number of active connections", []string{"protocol"}, nil)
+	connsTotalDesc = prometheus.NewDesc("gateway_connections_total",
+		"Total number of connections accepted", []string{"protocol"}, nil)
+	requestBytesDesc = prometheus.NewDesc("gateway_request_bytes_total",
+		"Total bytes transferred (request + response)", []string{"protocol", "direction"}, nil)
+	connDurationDesc = prometheus.NewDesc("gateway_connection_duration_seconds",
+		"Connection lifetime in seconds", []string{"protocol"}, nil)
+)
+
+// shardedCollector exposes the frontend to the default registry. Collect
+// walks every shard, which is a few thousand loads per scrape — noise next
+// to the per-event cost it removes from the hot path.
+type shardedCollector struct{}
+
+func (shardedCollector) Describe(ch chan<- *prometheus.Desc) {
+	ch <- activeConnsDesc
+	ch <- connsTotalDesc
+	ch <- requestBytesDesc
+	ch <- connDurationDesc
+}
+
+func (shardedCollector) Collect(ch chan<- prometheus.Metric) {
+	for p, name := range protoNames {
+		ch <- prometheus.MustNewConstMetric(activeConnsDesc, prometheus.GaugeValue,
+			float64(activeConns[p].total()), name)
+		ch <- prometheus.MustNewConstMetric(connsTotalDesc, prometheus.CounterValue,
+			float64(connsTotal[p].total()), name)
+		ch <- prometheus.MustNewConstMetric(requestBytesDesc, prometheus.CounterValue,
+			float64(requestBytesIn[p].total()), name, "in")
+		ch <- prometheus.MustNewConstMetric(requestBytesDesc, prometheus.CounterValue,
+			float64(requestBytesOut[p].total()), name, "out")
+		count, sum, buckets := connDurations[p].snapshot()
+		ch <- prometheus.MustNewConstHistogram(connDurationDesc, count, sum, buckets, name)
+	}
+}
+
+func init() {
+	prometheus.MustRegister(shardedCollector{})
+}
@@ -0,0 +1,109 @@
+package observability
+
+import (
+	"bytes"
+	"fmt"
+	"net/http"
+	"runtime/pprof"
+	"strconv"
+	"sync"
+	"time"
+
+	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
+)
+
+// Continuous CPU profiling parameters: one 1-second capture every 100
+// seconds is a 1% duty cycle, cheap enough to leave on in production while
+// still catching hot-path regressions in the window they happen instead of
+// requiring a redeploy with ad-hoc pprof imports.
+const (
+	profileInterval = 100 * time.Second
+	profileCapture  = 1 * time.Second
+	// profileHistory bounds the in-memory ring; at one snapshot per
+	// interval this retains roughly the last 20 minutes.
+	profileHistory = 12
+)
+
+type profileSnapshot struct {
+	takenAt time.Time
+	data    []byte
+}
+
+// ContinuousProfiler keeps a small ring of periodic CPU profile snapshots
+// in memory and serves them over HTTP, so a flamegraph covering a latency
+// spike can be pulled from the affected pod after the fact.
+type ContinuousProfiler struct {
+	mu        sync.Mutex
+	snapshots []profileSnapshot // oldest first
+}
+
+// StartContinuousProfiler begins the background sampling loop and returns
+// the handler to mount on the metrics mux.
+func StartContinuousProfiler() *ContinuousProfiler {
+	p := &ContinuousProfiler{}
+	go p.loop()
+	xlog.Infof("Continuous CPU profiler started (%v capture every %v)", profileCapture, profileInterval)
+	return p
+}
+
+func (p *ContinuousProfiler) loop() {
+	ticker := time.NewTicker(profileInterval)
+	defer ticker.Stop()
+	for range ticker.C {
+		var buf bytes.Buffer
+		// StartCPUProfile fails when an on-demand /debug/pprof/profile
+		// capture is in flight; skipping the cycle keeps the two from
+		// fighting over the single runtime profiler.
+		if err := pprof.StartCPUProfile(&buf); err != nil {
+			xlog.Debugf("Continuous profiler: capture skipped: %v", err)
+			continue
+		}
+		time.Sleep(profileCapture)
+		pprof.StopCPUProfile()
+
+		p.mu.Lock()
+		p.snapshots = append(p.snapshots, profileSnapshot{takenAt: time.Now(), data: buf.Bytes()})
+		if len(p.snapshots) > profileHistory {
+			p.snapshots = p.snapshots[len(p.snapshots)-profileHistory:]
+		}
+		p.mu.Unlock()
+	}
+}
+
+// ServeHTTP serves the snapshot ring. Without parameters it returns the
+// newest snapshot as a pprof proto (feed straight into `go tool pprof`);
+// ?list=1 returns a plain-text index and ?idx=N fetches a specific entry.
+func (p *ContinuousProfiler) ServeHTTP(w http.ResponseWriter, r *http.Request) {
+	p.mu.Lock()
+	snapshots := p.snapshots
+	p.mu.Unlock()
+
+	if len(snapshots) == 0 {
+		http.Error(w, "no snapshots captured yet", http.StatusNotFound)
+		return
+	}
+
+	if r.URL.Query().Get("list") != "" {
+		w.Header().Set("Content-Type", "text/plain; charset=utf-8")
+		for i, s := range snapshots {
+			fmt.Fprintf(w, "%d\t%s\t%d bytes\n", i, s.takenAt.Format(time.RFC3339), len(s.data))
+		}
+		return
+	}
+
+	idx := len(snapshots) - 1
+	if v := r.URL.Query().Get("idx"); v != "" {
+		n, err := strconv.Atoi(v)
+		if err != nil || n < 0 || n >= len(snapshots) {
+			http.Error(w, "invalid idx", http.StatusBadRequest)
+			return
+		}
+		idx = n
+	}
+
+	s := snapshots[idx]
+	w.Header().Set("Content-Type", "application/octet-stream")
+	w.Header().Set("Content-Disposition",
+		fmt.Sprintf(`attachment; filename="cpu-%s.pprof"`, s.takenAt.Format("20060102T150405")))
+	w.Write(s.data)
+}
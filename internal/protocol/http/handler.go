@@ -5,70 +5,129 @@ import (
 	"net/http"
 	"net/http/httputil"
 	"net/url"
+	"sync"
 	"time"
 
 	"github.com/SkynetNext/unified-access-gateway/internal/config"
+	"github.com/SkynetNext/unified-access-gateway/internal/discovery"
+	"github.com/SkynetNext/unified-access-gateway/internal/loadbalance"
 	"github.com/SkynetNext/unified-access-gateway/internal/middleware"
 	"github.com/SkynetNext/unified-access-gateway/internal/security"
 	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
 )
 
+// connQueueSize bounds the handoff queue between the sniffer and the shared
+// serving engine. Sends block once full, which applies natural backpressure
+// on the accept path instead of dropping connections.
+const connQueueSize = 256
+
+// Upstream pool defaults, used when backends.http leaves the corresponding
+// knobs unset. Deep enough that moderate concurrency reuses warm upstream
+// connections instead of dialing fresh ones per burst.
+const (
+	defaultMaxIdleConns        = 512
+	defaultMaxIdleConnsPerHost = 128
+	defaultIdleConnTimeout     = 90 * time.Second
+)
+
 type Handler struct {
-	proxy    *httputil.ReverseProxy
-	backend  string
-	security *security.Manager
+	// One reverse proxy per backend endpoint; the picker chooses among them
+	// per request with least-connections. Discovery updates add and remove
+	// entries at runtime, hence the sync.Map.
+	proxies   sync.Map // backend URL -> *httputil.ReverseProxy
+	picker    *loadbalance.Picker
+	security  *security.Manager
+	transport *http.Transport // shared by all backend proxies
+
+	// Shared serving engine: one long-lived http.Server consuming sniffed
+	// connections from connCh, instead of a throwaway server per connection.
+	server *http.Server
+	connCh chan net.Conn
 }
 
 func NewHandler(cfg *config.Config, sec *security.Manager) *Handler {
-	backend := cfg.Backends.HTTP.TargetURL
-	if backend == "" {
+	backends := cfg.Backends.HTTP.Targets()
+	if len(backends) == 0 {
 		// Business config MUST be loaded from Redis, no fallback
 		xlog.Errorf("CRITICAL: backends.http.target_url is not configured (must be set in Redis)")
 		return nil
 	}
 
-	target, err := url.Parse(backend)
-	if err != nil {
-		xlog.Errorf("CRITICAL: Invalid backend URL: %s, error: %v", backend, err)
-		return nil
+	// Shared upstream transport for all backend proxies. The zero-value
+	// Transport that ReverseProxy falls back to caps idle connections per
+	// host at 2, so anything beyond trivial concurrency dials fresh upstream
+	// connections; the pool limits keep a deep warm pool per backend
+	// instead, sized from backends.http (falling back to the defaults
+	// above when unset). HTTP/2 is negotiated automatically for TLS
+	// upstreams via ALPN (cleartext h2c would require a dedicated
+	// x/net-based transport; our upstreams speak HTTP/1.1 or TLS).
+	maxIdle := cfg.Backends.HTTP.MaxIdleConns
+	if maxIdle <= 0 {
+		maxIdle = defaultMaxIdleConns
+	}
+	maxIdlePerHost := cfg.Backends.HTTP.MaxIdleConnsPerHost
+	if maxIdlePerHost <= 0 {
+		maxIdlePerHost = defaultMaxIdleConnsPerHost
+	}
+	idleTimeout := cfg.Backends.HTTP.IdleConnTimeout
+	if idleTimeout <= 0 {
+		idleTimeout = defaultIdleConnTimeout
+	}
+	transport := &http.Transport{
+		Proxy: http.ProxyFromEnvironment,
+		DialContext: (&net.Dialer{
+			Timeout:   5 * time.Second,
+			KeepAlive: 30 * time.Second,
+		}).DialContext,
+		ForceAttemptHTTP2:     true,
+		MaxIdleConns:          maxIdle,
+		MaxIdleConnsPerHost:   maxIdlePerHost,
+		IdleConnTimeout:       idleTimeout,
+		TLSHandshakeTimeout:   10 * time.Second,
+		ExpectContinueTimeout: 1 * time.Second,
+	}
+	if cfg.Backends.HTTP.Timeout > 0 {
+		transport.ResponseHeaderTimeout = cfg.Backends.HTTP.Timeout
 	}
 
-	// Custom Director to support Metrics and Header modification
-	proxy := httputil.NewSingleHostReverseProxy(target)
-	originalDirector := proxy.Director
-	proxy.Director = func(req *http.Request) {
-		originalDirector(req)
-		// Add X-Forwarded-For or other headers here
-		req.Header.Set("X-Gateway-ID", "uag-v1")
-		// Set upstream identifier for metrics
-		req.Header.Set("X-Upstream", target.Host)
+	h := &Handler{
+		security:  sec,
+		transport: transport,
+		connCh:    make(chan net.Conn, connQueueSize),
 	}
 
-	// Custom ModifyResponse to record Status Code (Optional)
-	proxy.ModifyResponse = func(resp *http.Response) error {
-		// Log status code here for Access Log
+	valid := make([]string, 0, len(backends))
+	for _, backend := range backends {
+		proxy, err := h.newProxy(backend)
+		if err != nil {
+			xlog.Errorf("CRITICAL: Invalid backend URL: %s, error: %v", backend, err)
+			continue
+		}
+		h.proxies.Store(backend, proxy)
+		valid = append(valid, backend)
+	}
+	if len(valid) == 0 {
+		xlog.Errorf("CRITICAL: No valid HTTP backend URLs configured")
 		return nil
 	}
+	h.picker = loadbalance.NewPicker(valid)
 
-	return &Handler{
-		proxy:    proxy,
-		backend:  backend,
-		security: sec,
+	// Optionally track K8s service endpoints so scale-ups and pod churn
+	// reshape the backend set without a config push; the static list above
+	// keeps serving until the first resolution lands. Discovered endpoints
+	// inherit the scheme of the first static backend.
+	if svc := cfg.Backends.HTTP.DiscoveryService; svc != "" {
+		scheme := "http"
+		if target, err := url.Parse(valid[0]); err == nil && target.Scheme != "" {
+			scheme = target.Scheme
+		}
+		h.watchDiscovery(svc, scheme)
 	}
-}
-
-func (h *Handler) ServeConn(c net.Conn) {
-	// Metrics: Inc active connection
-	middleware.IncActiveConnections("http")
-	defer middleware.DecActiveConnections("http")
-
-	start := time.Now()
-
-	// Create a OneShotListener for this connection
-	l := &oneShotListener{c: c}
 
 	// Wrap handler to record metrics and security controls
 	wrappedHandler := http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		start := time.Now()
+
 		var denyErr error
 		denyStatus := http.StatusForbidden
 		if h.security != nil {
@@ -86,24 +145,136 @@ func (h *Handler) ServeConn(c net.Conn) {
 			}
 		}
 
+		// Least-connections pick per request; the slot is released when the
+		// response has been written back.
+		backend, release := h.picker.Pick()
+		v, ok := h.proxies.Load(backend)
+		if !ok {
+			// The endpoint left the set between pick and lookup (discovery
+			// shrink racing an in-flight request); fail the request rather
+			// than proxy to a removed backend.
+			release()
+			http.Error(w, "backend unavailable", http.StatusBadGateway)
+			return
+		}
 		recorder := &statusRecorder{ResponseWriter: w, statusCode: http.StatusOK}
-		h.proxy.ServeHTTP(recorder, r)
+		v.(*httputil.ReverseProxy).ServeHTTP(recorder, r)
+		release()
 
 		duration := time.Since(start)
+		// Passive health: gateway-generated errors (ReverseProxy writes 502
+		// when the upstream is unreachable) count against the endpoint's
+		// breaker; upstream application errors do not.
+		h.picker.Report(backend, recorder.statusCode != http.StatusBadGateway, duration)
 		if h.security != nil {
 			h.security.AuditHTTP(r, recorder.statusCode, duration, nil)
 		}
 	})
 
-	server := &http.Server{
+	h.server = &http.Server{
 		Handler:      middleware.K8sProbeMiddleware(middleware.CloudNativeMiddleware(wrappedHandler)),
 		ReadTimeout:  30 * time.Second,
 		WriteTimeout: 30 * time.Second,
+		// The active-connection gauge is incremented in ServeConn at
+		// handoff; decrement when the shared server releases the conn.
+		ConnState: func(c net.Conn, state http.ConnState) {
+			if state == http.StateClosed || state == http.StateHijacked {
+				middleware.DecActiveConnections("http")
+			}
+		},
 	}
 
-	if err := server.Serve(l); err != nil && err != ErrListenerClosed {
-		xlog.Debugf("HTTP Serve finished: %v", err)
+	go func() {
+		if err := h.server.Serve(&connListener{ch: h.connCh}); err != nil && err != http.ErrServerClosed {
+			xlog.Errorf("HTTP serving engine exited: %v", err)
+		}
+	}()
+
+	return h
+}
+
+// newProxy builds the reverse proxy for one backend URL over the shared
+// upstream transport.
+func (h *Handler) newProxy(backend string) (*httputil.ReverseProxy, error) {
+	target, err := url.Parse(backend)
+	if err != nil {
+		return nil, err
 	}
+
+	// Custom Director to support Metrics and Header modification
+	proxy := httputil.NewSingleHostReverseProxy(target)
+	proxy.Transport = h.transport
+	originalDirector := proxy.Director
+	targetHost := target.Host
+	proxy.Director = func(req *http.Request) {
+		originalDirector(req)
+		// Add X-Forwarded-For or other headers here
+		req.Header.Set("X-Gateway-ID", "uag-v1")
+		// Set upstream identifier for metrics
+		req.Header.Set("X-Upstream", targetHost)
+	}
+
+	// Custom ModifyResponse to record Status Code (Optional)
+	proxy.ModifyResponse = func(resp *http.Response) error {
+		// Log status code here for Access Log
+		return nil
+	}
+	return proxy, nil
+}
+
+// watchDiscovery subscribes the backend set to K8s endpoint changes for the
+// configured service ("name:port"). Each resolution maps the endpoint IPs to
+// scheme://ip:port backends and swaps them into the picker.
+func (h *Handler) watchDiscovery(service, scheme string) {
+	host, port, err := net.SplitHostPort(service)
+	if err != nil {
+		xlog.Errorf("Invalid backends.http.discovery_service %q (want name:port): %v", service, err)
+		return
+	}
+	discovery.NewK8sServiceDiscovery().WatchServiceEndpoints(host, func(ips []string) {
+		backends := make([]string, 0, len(ips))
+		for _, ip := range ips {
+			backends = append(backends, scheme+"://"+net.JoinHostPort(ip, port))
+		}
+		// Proxies for new endpoints exist before the picker can choose them;
+		// removed endpoints lose theirs only after the swap, so only requests
+		// already in flight can see a missing proxy (502-guarded at lookup).
+		for _, backend := range backends {
+			if _, ok := h.proxies.Load(backend); ok {
+				continue
+			}
+			proxy, err := h.newProxy(backend)
+			if err != nil {
+				xlog.Warnf("Skipping discovered backend %s: %v", backend, err)
+				continue
+			}
+			h.proxies.Store(backend, proxy)
+		}
+		if !h.picker.UpdateEndpoints(backends) {
+			return
+		}
+		keep := make(map[string]bool, len(backends))
+		for _, backend := range h.picker.Endpoints() {
+			keep[backend] = true
+		}
+		h.proxies.Range(func(k, _ any) bool {
+			if !keep[k.(string)] {
+				h.proxies.Delete(k)
+			}
+			return true
+		})
+		xlog.Infof("HTTP backend set updated from discovery (%s): %v", service, backends)
+	})
+	xlog.Infof("HTTP backend discovery watching service %s", service)
+}
+
+// ServeConn hands a sniffed connection to the shared serving engine.
+// Dispatch is a channel send; all per-connection server state is reused.
+func (h *Handler) ServeConn(c net.Conn) {
+	// Metrics: Inc active connection (Dec happens in the server's ConnState
+	// hook once the connection is fully closed)
+	middleware.IncActiveConnections("http")
+	h.connCh <- c
 }
 
 type statusRecorder struct {
@@ -116,26 +287,31 @@ func (sr *statusRecorder) WriteHeader(code int) {
 	sr.ResponseWriter.WriteHeader(code)
 }
 
-// oneShotListener is a helper struct
-type oneShotListener struct {
-	c    net.Conn
-	done bool
+// connListener adapts the handoff channel into a net.Listener so the shared
+// http.Server can Accept sniffed connections as they arrive.
+type connListener struct {
+	ch chan net.Conn
 }
 
-var ErrListenerClosed = net.ErrClosed
-
-func (l *oneShotListener) Accept() (net.Conn, error) {
-	if l.done {
-		return nil, ErrListenerClosed
+func (l *connListener) Accept() (net.Conn, error) {
+	c, ok := <-l.ch
+	if !ok {
+		return nil, net.ErrClosed
 	}
-	l.done = true
-	return l.c, nil
+	return c, nil
 }
 
-func (l *oneShotListener) Close() error {
+func (l *connListener) Close() error {
 	return nil
 }
 
-func (l *oneShotListener) Addr() net.Addr {
-	return l.c.LocalAddr()
+func (l *connListener) Addr() net.Addr {
+	return gatewayAddr{}
 }
+
+// gatewayAddr is the synthetic listener address reported by connListener;
+// the real local address lives on each handed-over connection.
+type gatewayAddr struct{}
+
+func (gatewayAddr) Network() string { return "tcp" }
+func (gatewayAddr) String() string  { return "uag-http" }
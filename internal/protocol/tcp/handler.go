@@ -1,39 +1,76 @@
 package tcp
 
 import (
-	"io"
 	"net"
+	"sync"
 	"time"
 
 	"github.com/SkynetNext/unified-access-gateway/internal/config"
+	"github.com/SkynetNext/unified-access-gateway/internal/discovery"
+	"github.com/SkynetNext/unified-access-gateway/internal/loadbalance"
 	"github.com/SkynetNext/unified-access-gateway/internal/middleware"
+	"github.com/SkynetNext/unified-access-gateway/internal/proxyproto"
 	"github.com/SkynetNext/unified-access-gateway/internal/security"
 	"github.com/SkynetNext/unified-access-gateway/pkg/ebpf"
 	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
 )
 
+// Batching parameters for eBPF pair registration. A short flush window
+// amortizes the map-update syscalls across connections accepted close
+// together (login storms) without delaying the fast path noticeably: the
+// userspace relay carries traffic until the registration lands.
+const (
+	regQueueSize    = 1024
+	regBatchSize    = 64
+	regFlushTimeout = 2 * time.Millisecond
+)
+
+// statsPollInterval controls how often kernel fast-path byte counters are
+// drained into Prometheus. Per-packet cost is zero either way; this only
+// bounds counter staleness.
+const statsPollInterval = 10 * time.Second
+
+// backendDialTimeout bounds both warm-pool refills and direct fallback dials.
+const backendDialTimeout = 5 * time.Second
+
 type Handler struct {
-	backendAddr string
-	sockMapMgr  *ebpf.SockMapManager
-	ebpfEnabled bool
-	security    *security.Manager
+	picker          *loadbalance.Picker
+	affinity        *loadbalance.AffinityCache // nil unless affinity_ttl is configured
+	pools           sync.Map                   // backend addr -> *dialPool; mutated by discovery updates
+	sockMapMgr      *ebpf.SockMapManager
+	ebpfEnabled     bool
+	security        *security.Manager
+	regCh           chan ebpf.SocketPair
+	sendProxyHeader bool
 }
 
-func NewHandler(cfg *config.Config, sec *security.Manager) *Handler {
-	addr := cfg.Backends.TCP.TargetAddr
-	if addr == "" {
+func NewHandler(cfg *config.Config, sec *security.Manager, store *config.RedisStore) *Handler {
+	addrs := cfg.Backends.TCP.Targets()
+	if len(addrs) == 0 {
 		// Business config MUST be loaded from Redis, no fallback
 		xlog.Errorf("CRITICAL: backends.tcp.target_addr is not configured (must be set in Redis)")
 		return nil
 	}
 
 	h := &Handler{
-		backendAddr: addr,
-		security:    sec,
+		picker:          loadbalance.NewPicker(addrs),
+		affinity:        loadbalance.NewAffinityCache(cfg.Backends.TCP.AffinityTTL, store),
+		security:        sec,
+		sendProxyHeader: cfg.Backends.TCP.ProxyProtocol,
+	}
+	// One warm pool per endpoint so a pooled connection always matches the
+	// endpoint the picker chose.
+	h.syncPools(h.picker.Endpoints())
+
+	// Optionally track K8s service endpoints so scale-ups and pod churn
+	// reshape the backend set without a config push; the static list above
+	// keeps serving until the first resolution lands.
+	if svc := cfg.Backends.TCP.DiscoveryService; svc != "" {
+		h.watchDiscovery(svc)
 	}
 
 	// Try to initialize eBPF SockMap (optional, graceful fallback)
-	mgr, err := ebpf.NewSockMapManager()
+	mgr, err := ebpf.NewSockMapManager(cfg.Server.SockMapMaxEntries)
 	if err != nil {
 		xlog.Infof("eBPF SockMap initialization failed (falling back to userspace): %v", err)
 		h.ebpfEnabled = false
@@ -47,12 +84,147 @@ func NewHandler(cfg *config.Config, sec *security.Manager) *Handler {
 			if err := mgr.AttachToCgroup(""); err != nil {
 				xlog.Infof("eBPF cgroup attachment failed (sockmap still works, but may have reduced performance): %v", err)
 			}
+			h.regCh = make(chan ebpf.SocketPair, regQueueSize)
+			go h.registerLoop()
+			// Surface kernel-redirected bytes in the same counters the
+			// userspace relay feeds, so capacity graphs see all traffic.
+			// The sink fires every poll, so it also keeps the occupancy
+			// gauge fresh (fast-path coverage vs configured map capacity).
+			mgr.StartStatsPoller(statsPollInterval, func(bytesIn, bytesOut uint64) {
+				middleware.AddTCPFastPathBytes(int64(bytesIn), int64(bytesOut))
+				middleware.SetSockmapEntries(mgr.Occupancy())
+			})
 		}
 	}
 
 	return h
 }
 
+// watchDiscovery subscribes the backend set to K8s endpoint changes for the
+// configured service ("name:port"). Each resolution maps the endpoint IPs to
+// addr:port and swaps them into the picker; pools follow the picker so warm
+// connections always target a live endpoint.
+func (h *Handler) watchDiscovery(service string) {
+	host, port, err := net.SplitHostPort(service)
+	if err != nil {
+		xlog.Errorf("Invalid backends.tcp.discovery_service %q (want name:port): %v", service, err)
+		return
+	}
+	discovery.NewK8sServiceDiscovery().WatchServiceEndpoints(host, func(ips []string) {
+		addrs := make([]string, 0, len(ips))
+		for _, ip := range ips {
+			addrs = append(addrs, net.JoinHostPort(ip, port))
+		}
+		// The picker swaps first, then pools reconcile: a new endpoint may
+		// briefly be picked before its pool exists (that pick just direct
+		// dials), and a removed endpoint's pool closes only after the picker
+		// stopped choosing it.
+		if !h.picker.UpdateEndpoints(addrs) {
+			return
+		}
+		h.syncPools(h.picker.Endpoints())
+		xlog.Infof("TCP backend set updated from discovery (%s): %v", service, addrs)
+	})
+	xlog.Infof("TCP backend discovery watching service %s", service)
+}
+
+// syncPools reconciles the warm-pool set with addrs: new endpoints get a
+// pool, removed endpoints have theirs closed (idle connections only;
+// connections already handed to sessions are owned by those sessions).
+func (h *Handler) syncPools(addrs []string) {
+	want := make(map[string]bool, len(addrs))
+	for _, addr := range addrs {
+		want[addr] = true
+		if _, ok := h.pools.Load(addr); !ok {
+			h.pools.Store(addr, newDialPool(addr, poolWarmSize, poolMaxIdle, backendDialTimeout))
+		}
+	}
+	h.pools.Range(func(k, v any) bool {
+		if !want[k.(string)] {
+			h.pools.Delete(k)
+			v.(*dialPool).Close()
+		}
+		return true
+	})
+}
+
+// registerLoop drains the registration queue and flushes pairs to the kernel
+// in batches, either when the batch fills up or after a short timeout.
+func (h *Handler) registerLoop() {
+	batch := make([]ebpf.SocketPair, 0, regBatchSize)
+	timer := time.NewTimer(regFlushTimeout)
+	timer.Stop()
+
+	flush := func() {
+		if len(batch) == 0 {
+			return
+		}
+		if err := h.sockMapMgr.RegisterSocketPairs(batch); err != nil {
+			middleware.AddSockmapRegisterFailures(len(batch))
+			xlog.Debugf("Failed to batch-register socket pairs in eBPF: %v", err)
+		}
+		batch = batch[:0]
+	}
+
+	for {
+		select {
+		case pair := <-h.regCh:
+			if len(batch) == 0 {
+				timer.Reset(regFlushTimeout)
+			}
+			batch = append(batch, pair)
+			if len(batch) >= regBatchSize {
+				if !timer.Stop() {
+					select {
+					case <-timer.C:
+					default:
+					}
+				}
+				flush()
+			}
+		case <-timer.C:
+			flush()
+		}
+	}
+}
+
+// pickBackend chooses the endpoint for a session. With affinity enabled it
+// first consults the cache under the client's identity; the remembered
+// endpoint is used only if PickAddr accepts it (configured and breaker
+// closed), so affinity degrades to plain least-connections the moment a
+// backend goes bad. The returned key is the affinity identity to refresh
+// after a successful dial ("" when affinity is off or the key is unusable).
+func (h *Handler) pickBackend(src net.Conn) (string, func(), string) {
+	if h.affinity == nil {
+		addr, release := h.picker.Pick()
+		return addr, release, ""
+	}
+	key := clientKey(src)
+	if key != "" {
+		if addr, ok := h.affinity.Get(key); ok {
+			if release, ok := h.picker.PickAddr(addr); ok {
+				return addr, release, key
+			}
+		}
+	}
+	addr, release := h.picker.Pick()
+	return addr, release, key
+}
+
+// clientKey is the affinity identity for a connection: the client IP without
+// the ephemeral port, so reconnects match. RemoteAddr already reflects a
+// PROXY header our own LB sent, so clients behind the LB keep distinct keys.
+func clientKey(src net.Conn) string {
+	if ta, ok := src.RemoteAddr().(*net.TCPAddr); ok {
+		return ta.IP.String()
+	}
+	host, _, err := net.SplitHostPort(src.RemoteAddr().String())
+	if err != nil {
+		return ""
+	}
+	return host
+}
+
 func (h *Handler) Handle(src net.Conn) {
 	// Metrics: Track active connections
 	middleware.IncActiveConnections("tcp")
@@ -63,78 +235,160 @@ func (h *Handler) Handle(src net.Conn) {
 	startTime := time.Now()
 	var bytesIn, bytesOut int64
 
-	// Connect to backend with timeout
-	connTimeout := 5 * time.Second
+	// Pick the backend endpoint — the client's remembered one when session
+	// affinity is on and that endpoint is healthy, least-loaded otherwise.
+	// Release its connection slot when this session finishes so in-flight
+	// counts stay accurate.
+	backendAddr, release, affinityKey := h.pickBackend(src)
+	defer release()
+
+	// Fetch a backend connection: a warm pooled one when available (skipping
+	// the backend handshake entirely), otherwise a direct dial with timeout.
+	// Direct dials under eBPF plant a pairing intent so the sockops program
+	// pairs the sockets inside the handshake — the fast path is live from
+	// the first backend byte, which is what makes it engage at all for
+	// short-lived sessions. Warm pooled connections were dialed before any
+	// client existed, so they take the userspace registration path below.
 	dialStartTime := time.Now()
-	dst, err := net.DialTimeout("tcp", h.backendAddr, connTimeout)
+	var (
+		dst    net.Conn
+		err    error
+		paired bool
+	)
+	if pool, ok := h.pools.Load(backendAddr); ok {
+		if warm, ok := pool.(*dialPool).GetIdle(); ok {
+			dst = warm
+		}
+	}
+	if dst == nil {
+		if h.ebpfEnabled && !h.sendProxyHeader {
+			// With PROXY protocol enabled the header must reach the backend
+			// before any redirected client bytes, so those sessions keep the
+			// post-header registration path.
+			dst, paired, err = h.sockMapMgr.DialWithIntent(src, backendAddr, backendDialTimeout)
+		} else {
+			dst, err = net.DialTimeout("tcp", backendAddr, backendDialTimeout)
+		}
+	}
 	dialDuration := time.Since(dialStartTime)
 	if err != nil {
-		xlog.Errorf("Failed to dial backend %s: %v", h.backendAddr, err)
+		xlog.Errorf("Failed to dial backend %s: %v", backendAddr, err)
+		// Passive health: a failed dial counts against the endpoint's
+		// breaker, so a dead backend trips open instead of eating live
+		// traffic until the next active health-check tick.
+		h.picker.Report(backendAddr, false, dialDuration)
 		if h.security != nil {
-			h.security.AuditTCP(src.RemoteAddr().String(), h.backendAddr, false, err.Error())
+			h.security.AuditTCP(src.RemoteAddr().String(), backendAddr, false, err.Error())
 		}
 		// Record failed connection metrics (dial time even for failures)
-		middleware.RecordUpstreamRequest(h.backendAddr, "connection_failed", dialDuration.Seconds())
+		middleware.RecordUpstreamRequest(backendAddr, "connection_failed", dialDuration.Seconds())
 		return
 	}
 	defer dst.Close()
 
 	// Record connection establishment time (dial time) for TCP
 	// This is the meaningful latency metric for TCP transparent proxy
-	middleware.RecordUpstreamRequest(h.backendAddr, "success", dialDuration.Seconds())
+	h.picker.Report(backendAddr, true, dialDuration)
+	middleware.RecordUpstreamRequest(backendAddr, "success", dialDuration.Seconds())
+	// Remember the pairing (and refresh its TTL) only once the backend proved
+	// reachable, so a bad pick is not reinforced.
+	if h.affinity != nil && affinityKey != "" {
+		h.affinity.Set(affinityKey, backendAddr)
+	}
+	// Pipeline stage: dispatch to backend readiness. The first backend byte
+	// (PROXY header or first relayed payload) goes out immediately after
+	// this point, so the stage covers goroutine handoff plus pool-get/dial.
+	middleware.ObserveDispatchToBackend(time.Since(startTime).Seconds())
 
 	xlog.Infof("TCP Proxy: %s <-> %s", src.RemoteAddr(), dst.RemoteAddr())
 	if h.security != nil {
-		h.security.AuditTCP(src.RemoteAddr().String(), h.backendAddr, true, "")
+		h.security.AuditTCP(src.RemoteAddr().String(), backendAddr, true, "")
 	}
 
-	// Register socket pair for eBPF redirection (if enabled)
-	if h.ebpfEnabled {
-		if err := h.sockMapMgr.RegisterSocketPair(src, dst); err != nil {
-			xlog.Debugf("Failed to register socket pair in eBPF: %v", err)
-		} else {
-			xlog.Debugf("Socket pair registered in eBPF SockMap")
+	// Emit a PROXY v2 header before any payload (and before the eBPF fast
+	// path can engage), so the backend sees the real client address. The
+	// sniffed connection's RemoteAddr already reflects a header our own LB
+	// sent, so the client address survives both hops.
+	if h.sendProxyHeader {
+		if err := writeProxyV2(dst, src); err != nil {
+			xlog.Errorf("Failed to send PROXY header to %s: %v", backendAddr, err)
+			middleware.RecordUpstreamRequest(backendAddr, "connection_failed", 0)
+			return
+		}
+	}
+
+	// Register socket pair for eBPF redirection (if enabled).
+	// Registration goes through the batching queue so the accept path does
+	// not pay the map-update syscalls itself. If the queue is full (extreme
+	// burst), register inline rather than lose the fast path. Either way the
+	// sockops program also removes entries on TCP_CLOSE, so a late flush
+	// racing with UnregisterSocketPair cannot leak entries.
+	if h.ebpfEnabled && paired {
+		// The kernel paired the sockets at handshake time; only the teardown
+		// bookkeeping (final stats flush, map hygiene) remains ours.
+		defer h.sockMapMgr.UnregisterSocketPair(src, dst)
+	} else if h.ebpfEnabled {
+		select {
+		case h.regCh <- ebpf.SocketPair{Client: src, Backend: dst}:
 			defer h.sockMapMgr.UnregisterSocketPair(src, dst)
+		default:
+			if err := h.sockMapMgr.RegisterSocketPair(src, dst); err != nil {
+				middleware.AddSockmapRegisterFailures(1)
+				xlog.Debugf("Failed to register socket pair in eBPF: %v", err)
+			} else {
+				xlog.Debugf("Socket pair registered in eBPF SockMap")
+				defer h.sockMapMgr.UnregisterSocketPair(src, dst)
+			}
 		}
 	}
 
-	// Bidirectional Copy (userspace fallback + eBPF acceleration)
+	// Bidirectional relay (userspace fallback + eBPF acceleration)
 	// Even with eBPF, we need this for initial packets and fallback
-	// eBPF will handle most packets at kernel level after registration
-	errChan := make(chan error, 2)
-	bytesChan := make(chan struct{ in, out int64 }, 2)
+	// eBPF will handle most packets at kernel level after registration.
+	// relayCopy unwraps the sniffed connection so io.Copy can splice
+	// between the raw sockets without copying through userspace.
+	//
+	// The downstream direction runs on this goroutine; only the upstream
+	// copy gets its own, so a session costs one extra goroutine and one
+	// channel instead of two of each. Whichever side finishes first closes
+	// both sockets, which unblocks the other copy.
+	upstreamDone := make(chan int64, 1)
 
 	go func() {
 		// src -> dst (Upstream)
-		n, err := io.Copy(dst, src)
-		bytesChan <- struct{ in, out int64 }{in: n, out: 0}
-		errChan <- err
+		n, _ := relayCopy(dst, src)
+		src.Close()
+		dst.Close()
+		upstreamDone <- n
 	}()
 
-	go func() {
-		// dst -> src (Downstream)
-		n, err := io.Copy(src, dst)
-		bytesChan <- struct{ in, out int64 }{in: 0, out: n}
-		errChan <- err
-	}()
-
-	// Wait for any side to close
-	<-errChan
-
-	// Collect bytes transferred from both directions
-	for i := 0; i < 2; i++ {
-		select {
-		case b := <-bytesChan:
-			bytesIn += b.in
-			bytesOut += b.out
-		default:
-		}
-	}
+	// dst -> src (Downstream)
+	bytesOut, _ = relayCopy(src, dst)
+	src.Close()
+	dst.Close()
+	bytesIn = <-upstreamDone
 
 	// Record TCP metrics
 	duration := time.Since(startTime)
-	middleware.RecordTCPMetrics(h.backendAddr, duration.Seconds(), bytesIn, bytesOut)
+	middleware.RecordTCPMetrics(backendAddr, duration.Seconds(), bytesIn, bytesOut)
 	middleware.RecordConnectionDuration("tcp", duration.Seconds())
 
 	// Note: Upstream request latency (dial time) is already recorded after connection establishment
 }
+
+// writeProxyV2 sends a PROXY v2 header on the backend connection describing
+// the client session: src is the real client (RemoteAddr honors a header our
+// own LB sent), dst the address the client connected to. Non-TCP addresses
+// cannot be described, so the header is skipped rather than sent as UNSPEC.
+func writeProxyV2(backend, client net.Conn) error {
+	srcAddr, srcOK := client.RemoteAddr().(*net.TCPAddr)
+	dstAddr, dstOK := client.LocalAddr().(*net.TCPAddr)
+	if !srcOK || !dstOK {
+		xlog.Debugf("Skipping PROXY header for %s: non-TCP addresses", client.RemoteAddr())
+		return nil
+	}
+	// Fixed part + TCP6 address block; fits the largest header we emit.
+	hdr := proxyproto.AppendV2(make([]byte, 0, proxyproto.V2HeaderLen+36), srcAddr, dstAddr)
+	_, err := backend.Write(hdr)
+	return err
+}
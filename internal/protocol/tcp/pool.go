@@ -0,0 +1,121 @@
+package tcp
+
+import (
+	"net"
+	"time"
+
+	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
+)
+
+// Pool tuning. A relay session consumes its backend connection, so pooled
+// connections are never returned after carrying traffic — the pool is a warm
+// standby of pre-established connections refilled in the background, letting
+// the accept path skip the backend TCP handshake entirely.
+const (
+	poolWarmSize = 32
+	// poolMaxIdle bounds how long a pre-dialed connection may sit unused.
+	// Aging out is the liveness strategy: probing an idle connection with a
+	// read would eat the first bytes of server-speaks-first protocols, so we
+	// rely on rotation plus TCP keepalive instead.
+	poolMaxIdle = 30 * time.Second
+	// poolRetryBackoff paces redials while the backend is unreachable.
+	poolRetryBackoff = time.Second
+)
+
+// pooledConn is an idle backend connection with its dial timestamp.
+type pooledConn struct {
+	conn     net.Conn
+	dialedAt time.Time
+}
+
+// dialPool keeps pre-established connections to a single backend address.
+type dialPool struct {
+	addr    string
+	timeout time.Duration
+	maxIdle time.Duration
+	idle    chan pooledConn
+	stop    chan struct{}
+}
+
+func newDialPool(addr string, size int, maxIdle, dialTimeout time.Duration) *dialPool {
+	p := &dialPool{
+		addr:    addr,
+		timeout: dialTimeout,
+		maxIdle: maxIdle,
+		idle:    make(chan pooledConn, size),
+		stop:    make(chan struct{}),
+	}
+	go p.fillLoop()
+	return p
+}
+
+// Get returns a warm backend connection if one is available, otherwise it
+// dials directly so callers see the same errors they would without a pool.
+func (p *dialPool) Get() (net.Conn, error) {
+	if conn, ok := p.GetIdle(); ok {
+		return conn, nil
+	}
+	return net.DialTimeout("tcp", p.addr, p.timeout)
+}
+
+// GetIdle returns a warm connection without falling back to a dial, letting
+// callers that want to control the dial themselves (e.g. intent-planted
+// eBPF dials) distinguish the two cases.
+func (p *dialPool) GetIdle() (net.Conn, bool) {
+	for {
+		select {
+		case pc := <-p.idle:
+			if time.Since(pc.dialedAt) > p.maxIdle {
+				pc.conn.Close()
+				continue
+			}
+			return pc.conn, true
+		default:
+			return nil, false
+		}
+	}
+}
+
+// fillLoop keeps the idle channel topped up. The blocking send doubles as
+// the "pool full" condition; while the backend is unreachable it backs off
+// and Get falls through to direct dials that surface the error.
+func (p *dialPool) fillLoop() {
+	for {
+		select {
+		case <-p.stop:
+			return
+		default:
+		}
+
+		conn, err := net.DialTimeout("tcp", p.addr, p.timeout)
+		if err != nil {
+			xlog.Debugf("Dial pool: backend %s unreachable: %v", p.addr, err)
+			select {
+			case <-time.After(poolRetryBackoff):
+			case <-p.stop:
+				return
+			}
+			continue
+		}
+
+		select {
+		case p.idle <- pooledConn{conn: conn, dialedAt: time.Now()}:
+		case <-p.stop:
+			conn.Close()
+			return
+		}
+	}
+}
+
+// Close stops the filler and drops all idle connections.
+func (p *dialPool) Close() {
+	close(p.stop)
+	for {
+		select {
+		case pc := <-p.idle:
+			pc.conn.Close()
+		default:
+			return
+		}
+	}
+}
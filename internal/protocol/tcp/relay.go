@@ -0,0 +1,127 @@
+package tcp
+
+import (
+	"io"
+	"net"
+	"sync"
+)
+
+// bufferedConn is implemented by core.SniffConn (declared locally to avoid
+// an import cycle with internal/core): a connection holding sniffed bytes in
+// a userspace buffer in front of the raw socket.
+type bufferedConn interface {
+	net.Conn
+	Unwrap() net.Conn
+	WriteBufferedTo(w io.Writer) (int64, error)
+}
+
+// unwrappable matches ebpf.UnwrappableConn without forcing every caller
+// through that package.
+type unwrappable interface {
+	Unwrap() net.Conn
+}
+
+// relayCopy moves bytes from src to dst for one direction of a proxied
+// session. Wrapped connections defeat the runtime's splice(2)/sendfile fast
+// path in io.Copy (it only fires for raw *net.TCPConn pairs), so any sniff
+// buffer is flushed first and both sides are unwrapped before copying. On
+// Linux this makes the userspace fallback zero-copy: bytes move between the
+// sockets through a kernel pipe without surfacing into the process.
+func relayCopy(dst, src net.Conn) (int64, error) {
+	var flushed int64
+	if bc, ok := src.(bufferedConn); ok {
+		n, err := bc.WriteBufferedTo(dst)
+		flushed = n
+		if err != nil {
+			return flushed, err
+		}
+	}
+	src = unwrapAll(src)
+	dst = unwrapAll(dst)
+
+	// A raw socket pair splices inside io.Copy with no userspace buffer at
+	// all. Everything else — TLS-terminated sessions keep *tls.Conn in the
+	// path — copies through a pooled, adaptively sized buffer instead of
+	// io.Copy's per-call 32KB scratch allocation.
+	if _, ok := src.(*net.TCPConn); ok {
+		if _, ok := dst.(*net.TCPConn); ok {
+			n, err := io.Copy(dst, src)
+			return flushed + n, err
+		}
+	}
+	n, err := copyAdaptive(dst, src)
+	return flushed + n, err
+}
+
+// Tiered relay buffers for the non-splice path. Connections start on the
+// smallest tier — a chatty game session never needs more — and step up only
+// on sustained throughput, so idle and low-rate sessions hold 2KB instead
+// of two 32KB scratch buffers each.
+var relayBufSizes = [...]int{2 << 10, 8 << 10, 32 << 10}
+
+var relayBufPools = func() [len(relayBufSizes)]*sync.Pool {
+	var pools [len(relayBufSizes)]*sync.Pool
+	for i, size := range relayBufSizes {
+		size := size
+		pools[i] = &sync.Pool{New: func() interface{} { return make([]byte, size) }}
+	}
+	return pools
+}()
+
+// growAfterFullReads is how many consecutive reads must fill the current
+// buffer before the copy loop steps up a tier: a completely filled buffer
+// means the kernel had more data queued than we could take, the copy-loop
+// signature of a bulk transfer.
+const growAfterFullReads = 4
+
+// copyAdaptive moves bytes from src to dst through a pooled buffer whose
+// size tracks the connection's observed throughput. The buffer returns to
+// its tier's pool when the direction finishes.
+func copyAdaptive(dst io.Writer, src io.Reader) (int64, error) {
+	tier := 0
+	buf := relayBufPools[tier].Get().([]byte)
+	fullReads := 0
+	var written int64
+	for {
+		n, rerr := src.Read(buf)
+		if n > 0 {
+			w, werr := dst.Write(buf[:n])
+			written += int64(w)
+			if werr != nil {
+				relayBufPools[tier].Put(buf)
+				return written, werr
+			}
+			if n == len(buf) && tier < len(relayBufPools)-1 {
+				fullReads++
+				if fullReads >= growAfterFullReads {
+					relayBufPools[tier].Put(buf)
+					tier++
+					buf = relayBufPools[tier].Get().([]byte)
+					fullReads = 0
+				}
+			} else {
+				fullReads = 0
+			}
+		}
+		if rerr != nil {
+			relayBufPools[tier].Put(buf)
+			if rerr == io.EOF {
+				rerr = nil
+			}
+			return written, rerr
+		}
+	}
+}
+
+// unwrapAll peels off every wrapper layer (sniff buffer, connection
+// tracking) down to the raw socket, so splice still fires when a connection
+// is wrapped more than once.
+func unwrapAll(c net.Conn) net.Conn {
+	for {
+		uc, ok := c.(unwrappable)
+		if !ok {
+			return c
+		}
+		c = uc.Unwrap()
+	}
+}
@@ -0,0 +1,115 @@
+//go:build linux
+
+package udp
+
+import (
+	"net"
+	"syscall"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+// batchSize is how many datagrams one recvmmsg call can return. 64 keeps the
+// per-wakeup work bounded while cutting the receive syscall count by up to
+// 64x under load; at game-traffic packet rates the syscall boundary, not the
+// copy, is the dominant per-packet cost.
+const batchSize = 64
+
+// mmsghdr mirrors struct mmsghdr on 64-bit Linux: a msghdr plus the number
+// of bytes the kernel filled into that slot.
+type mmsghdr struct {
+	hdr    unix.Msghdr
+	msgLen uint32
+	_      [4]byte
+}
+
+// batchReader drains the listening socket with recvmmsg: one syscall per
+// batch of datagrams instead of one per datagram, integrated with the
+// runtime poller via RawConn.Read so the loop still parks cheaply when the
+// socket is quiet. All buffers are allocated once; slot contents are valid
+// until the next read call.
+type batchReader struct {
+	raw   syscall.RawConn
+	hdrs  [batchSize]mmsghdr
+	iovs  [batchSize]unix.Iovec
+	names [batchSize][unix.SizeofSockaddrInet6]byte
+	bufs  [batchSize][maxDatagramSize]byte
+}
+
+func newBatchReader(conn *net.UDPConn) (*batchReader, error) {
+	raw, err := conn.SyscallConn()
+	if err != nil {
+		return nil, err
+	}
+	b := &batchReader{raw: raw}
+	for i := range b.hdrs {
+		b.iovs[i] = unix.Iovec{Base: &b.bufs[i][0], Len: maxDatagramSize}
+		b.hdrs[i].hdr.Name = &b.names[i][0]
+		b.hdrs[i].hdr.Iov = &b.iovs[i]
+		b.hdrs[i].hdr.Iovlen = 1
+	}
+	return b, nil
+}
+
+// read blocks until at least one datagram is available and returns how many
+// slots the kernel filled.
+func (b *batchReader) read() (int, error) {
+	// The kernel overwrites Namelen with the actual sockaddr size; reset it
+	// before each call so reuse does not shrink the address buffers.
+	for i := range b.hdrs {
+		b.hdrs[i].hdr.Namelen = unix.SizeofSockaddrInet6
+	}
+	var n int
+	var errno syscall.Errno
+	err := b.raw.Read(func(fd uintptr) bool {
+		r1, _, e := unix.Syscall6(unix.SYS_RECVMMSG, fd,
+			uintptr(unsafe.Pointer(&b.hdrs[0])), batchSize, unix.MSG_DONTWAIT, 0, 0)
+		if e == unix.EAGAIN {
+			return false // park on the runtime poller until readable
+		}
+		n, errno = int(r1), e
+		return true
+	})
+	if err != nil {
+		return 0, err
+	}
+	if errno != 0 {
+		return 0, errno
+	}
+	return n, nil
+}
+
+func (b *batchReader) payload(i int) []byte {
+	return b.bufs[i][:b.hdrs[i].msgLen]
+}
+
+// key builds the session key straight from the raw sockaddr, with no
+// allocation on the per-packet path.
+func (b *batchReader) key(i int) sessionKey {
+	var k sessionKey
+	name := &b.names[i]
+	// sa_family is in host byte order, the port in network byte order.
+	switch *(*uint16)(unsafe.Pointer(&name[0])) {
+	case unix.AF_INET:
+		copy(k.ip[:4], name[4:8])
+	case unix.AF_INET6:
+		copy(k.ip[:], name[8:24])
+	}
+	k.port = uint16(name[2])<<8 | uint16(name[3])
+	return k
+}
+
+// udpAddr materializes the sender address; only called on session creation,
+// so its allocations stay off the steady-state path.
+func (b *batchReader) udpAddr(i int) *net.UDPAddr {
+	name := &b.names[i]
+	addr := &net.UDPAddr{Port: int(name[2])<<8 | int(name[3])}
+	switch *(*uint16)(unsafe.Pointer(&name[0])) {
+	case unix.AF_INET:
+		addr.IP = append(net.IP(nil), name[4:8]...)
+	case unix.AF_INET6:
+		addr.IP = append(net.IP(nil), name[8:24]...)
+	}
+	return addr
+}
@@ -0,0 +1,33 @@
+//go:build !linux
+
+package udp
+
+import "net"
+
+// batchSize on non-Linux platforms: no recvmmsg, so the portable path reads
+// one datagram per wakeup via ReadFromUDP.
+const batchSize = 1
+
+type batchReader struct {
+	conn *net.UDPConn
+	buf  [maxDatagramSize]byte
+	n    int
+	addr *net.UDPAddr
+}
+
+func newBatchReader(conn *net.UDPConn) (*batchReader, error) {
+	return &batchReader{conn: conn}, nil
+}
+
+func (b *batchReader) read() (int, error) {
+	n, addr, err := b.conn.ReadFromUDP(b.buf[:])
+	if err != nil {
+		return 0, err
+	}
+	b.n, b.addr = n, addr
+	return 1, nil
+}
+
+func (b *batchReader) payload(int) []byte       { return b.buf[:b.n] }
+func (b *batchReader) key(int) sessionKey       { return keyFromUDPAddr(b.addr) }
+func (b *batchReader) udpAddr(int) *net.UDPAddr { return b.addr }
@@ -0,0 +1,263 @@
+// Package udp implements the datagram side of the gateway: a session-based
+// relay for raw UDP traffic and QUIC passthrough. QUIC is not terminated
+// (that would require a full QUIC stack); each client flow is pinned to one
+// backend for its lifetime, which is all QUIC needs from an L4 relay — the
+// connection ID machinery tolerates a dumb forwarder as long as the mapping
+// is stable. Sessions share the security manager and metrics pipeline with
+// the TCP/HTTP paths.
+package udp
+
+import (
+	"errors"
+	"net"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/SkynetNext/unified-access-gateway/internal/config"
+	"github.com/SkynetNext/unified-access-gateway/internal/loadbalance"
+	"github.com/SkynetNext/unified-access-gateway/internal/middleware"
+	"github.com/SkynetNext/unified-access-gateway/internal/security"
+	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
+)
+
+// maxDatagramSize bounds a single relayed datagram. QUIC caps UDP payloads
+// near the path MTU (at most ~1452 on typical paths), so 2KB leaves headroom
+// without wasting buffer space per batch slot.
+const maxDatagramSize = 2048
+
+// defaultIdleTimeout evicts sessions with no traffic in either direction.
+// QUIC's own default idle timeout is 30s, so 60s never cuts a live flow.
+const defaultIdleTimeout = 60 * time.Second
+
+// sessionKey identifies a client flow without the per-packet allocation a
+// stringified-address map key would need; the read loop builds it straight
+// from the received sockaddr.
+type sessionKey struct {
+	ip   [16]byte
+	port uint16
+}
+
+func keyFromUDPAddr(a *net.UDPAddr) sessionKey {
+	var k sessionKey
+	if ip4 := a.IP.To4(); ip4 != nil {
+		copy(k.ip[:4], ip4)
+	} else {
+		copy(k.ip[:], a.IP.To16())
+	}
+	k.port = uint16(a.Port)
+	return k
+}
+
+type Handler struct {
+	listenAddr  string
+	idleTimeout time.Duration
+	picker      *loadbalance.Picker
+	security    *security.Manager
+
+	conn     *net.UDPConn
+	sessions sync.Map // sessionKey -> *session
+	closed   atomic.Bool
+}
+
+// session is one client flow pinned to one backend via a connected UDP
+// socket. The downstream goroutine owns the lifetime: it relays backend
+// replies and evicts the session on idle timeout.
+type session struct {
+	key         sessionKey
+	clientAddr  *net.UDPAddr
+	backend     *net.UDPConn
+	backendAddr string
+	release     func()
+	started     time.Time
+	lastActive  atomic.Int64 // UnixNano of the last datagram either way
+	bytesIn     atomic.Int64 // client -> backend
+	bytesOut    atomic.Int64 // backend -> client
+	done        atomic.Bool  // guards single teardown
+}
+
+// NewHandler builds the UDP relay, or nil when the UDP side is not
+// configured. Unlike the TCP/HTTP backends, UDP is optional and its absence
+// is not an error.
+func NewHandler(cfg *config.Config, sec *security.Manager) *Handler {
+	addrs := cfg.Backends.UDP.Targets()
+	if cfg.Server.UDPListenAddr == "" || len(addrs) == 0 {
+		return nil
+	}
+	idle := cfg.Backends.UDP.IdleTimeout
+	if idle <= 0 {
+		idle = defaultIdleTimeout
+	}
+	return &Handler{
+		listenAddr:  cfg.Server.UDPListenAddr,
+		idleTimeout: idle,
+		picker:      loadbalance.NewPicker(addrs),
+		security:    sec,
+	}
+}
+
+// ListenAndServe runs the read loop until Close. A single goroutine drains
+// the listening socket in recvmmsg batches (see batch_linux.go); backend
+// replies run on one goroutine per session.
+func (h *Handler) ListenAndServe() error {
+	addr, err := net.ResolveUDPAddr("udp", h.listenAddr)
+	if err != nil {
+		return err
+	}
+	conn, err := net.ListenUDP("udp", addr)
+	if err != nil {
+		return err
+	}
+	h.conn = conn
+
+	reader, err := newBatchReader(conn)
+	if err != nil {
+		conn.Close()
+		return err
+	}
+	xlog.Infof("UDP listener started on %s (QUIC passthrough, backends=%d, idle_timeout=%v, batch=%d)",
+		h.listenAddr, len(h.picker.Endpoints()), h.idleTimeout, batchSize)
+
+	for {
+		n, err := reader.read()
+		if err != nil {
+			if h.closed.Load() || errors.Is(err, net.ErrClosed) {
+				return nil
+			}
+			xlog.Warnf("UDP read error: %v", err)
+			continue
+		}
+		for i := 0; i < n; i++ {
+			h.dispatch(reader, i)
+		}
+	}
+}
+
+// dispatch routes one received datagram: existing sessions forward with a
+// single lock-free map load; new clients go through the security check and a
+// backend pick first. Runs on the read-loop goroutine, so the per-packet
+// path is one map load plus one UDP send.
+func (h *Handler) dispatch(r *batchReader, i int) {
+	key := r.key(i)
+	if v, ok := h.sessions.Load(key); ok {
+		v.(*session).forward(h, r.payload(i))
+		return
+	}
+
+	clientAddr := r.udpAddr(i)
+	if h.security != nil {
+		if err := h.security.CheckConnection(clientAddr); err != nil {
+			h.security.AuditTCP(clientAddr.String(), "", false, err.Error())
+			xlog.Debugf("UDP datagram from %s rejected: %v", clientAddr, err)
+			return
+		}
+	}
+	h.newSession(key, clientAddr, r.payload(i))
+}
+
+func (h *Handler) newSession(key sessionKey, clientAddr *net.UDPAddr, payload []byte) {
+	backendAddr, release := h.picker.Pick()
+	dialStart := time.Now()
+	raddr, err := net.ResolveUDPAddr("udp", backendAddr)
+	var backend *net.UDPConn
+	if err == nil {
+		backend, err = net.DialUDP("udp", nil, raddr)
+	}
+	if err != nil {
+		release()
+		xlog.Errorf("Failed to dial UDP backend %s: %v", backendAddr, err)
+		h.picker.Report(backendAddr, false, time.Since(dialStart))
+		middleware.RecordUpstreamRequest(backendAddr, "connection_failed", time.Since(dialStart).Seconds())
+		return
+	}
+	// A UDP "dial" is just a local connect with no handshake, so success here
+	// only proves a route exists; the breaker learns real backend failures
+	// from ICMP-unreachable errors surfacing on the connected socket.
+	h.picker.Report(backendAddr, true, time.Since(dialStart))
+	middleware.RecordUpstreamRequest(backendAddr, "success", time.Since(dialStart).Seconds())
+
+	middleware.IncActiveConnections("udp")
+	s := &session{
+		key:         key,
+		clientAddr:  clientAddr,
+		backend:     backend,
+		backendAddr: backendAddr,
+		release:     release,
+		started:     time.Now(),
+	}
+	s.lastActive.Store(time.Now().UnixNano())
+	h.sessions.Store(key, s)
+	if h.security != nil {
+		h.security.AuditTCP(clientAddr.String(), backendAddr, true, "")
+	}
+	xlog.Infof("UDP session: %s <-> %s", clientAddr, backendAddr)
+	go s.downstream(h)
+	s.forward(h, payload)
+}
+
+// forward relays one client datagram upstream. Called from the read loop, so
+// it must not block beyond the UDP send itself.
+func (s *session) forward(h *Handler, payload []byte) {
+	n, err := s.backend.Write(payload)
+	s.bytesIn.Add(int64(n))
+	s.lastActive.Store(time.Now().UnixNano())
+	if err != nil {
+		xlog.Debugf("UDP forward to %s failed: %v", s.backendAddr, err)
+		h.picker.Report(s.backendAddr, false, 0)
+	}
+}
+
+// downstream relays backend replies to the client and owns session lifetime:
+// the read deadline doubles as the idle check, so an idle session costs one
+// timer wakeup per timeout period and nothing else.
+func (s *session) downstream(h *Handler) {
+	defer h.teardown(s)
+	buf := make([]byte, maxDatagramSize)
+	for {
+		s.backend.SetReadDeadline(time.Now().Add(h.idleTimeout))
+		n, err := s.backend.Read(buf)
+		if n > 0 {
+			s.bytesOut.Add(int64(n))
+			s.lastActive.Store(time.Now().UnixNano())
+			if _, werr := h.conn.WriteToUDP(buf[:n], s.clientAddr); werr != nil {
+				xlog.Debugf("UDP reply to %s failed: %v", s.clientAddr, werr)
+			}
+		}
+		if err != nil {
+			if ne, ok := err.(net.Error); ok && ne.Timeout() {
+				if time.Duration(time.Now().UnixNano()-s.lastActive.Load()) < h.idleTimeout {
+					continue // client kept sending; only the backend was quiet
+				}
+			}
+			return
+		}
+	}
+}
+
+// teardown closes the session exactly once and flushes its metrics.
+func (h *Handler) teardown(s *session) {
+	if !s.done.CompareAndSwap(false, true) {
+		return
+	}
+	h.sessions.Delete(s.key)
+	s.backend.Close()
+	s.release()
+	duration := time.Since(s.started)
+	middleware.DecActiveConnections("udp")
+	middleware.RecordUDPMetrics(s.backendAddr, duration.Seconds(), s.bytesIn.Load(), s.bytesOut.Load())
+	middleware.RecordConnectionDuration("udp", duration.Seconds())
+}
+
+// Close stops the read loop and tears down all live sessions.
+func (h *Handler) Close() {
+	if h == nil || !h.closed.CompareAndSwap(false, true) {
+		return
+	}
+	if h.conn != nil {
+		h.conn.Close()
+	}
+	h.sessions.Range(func(_, v any) bool {
+		v.(*session).backend.Close() // unblocks downstream, which tears down
+		return true
+	})
+}
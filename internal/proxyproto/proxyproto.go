@@ -0,0 +1,137 @@
+// Package proxyproto implements the binary PROXY protocol version 2
+// (haproxy.org/download/2.4/doc/proxy-protocol.txt) for both directions:
+// stripping a header sent by the fronting load balancer to recover the real
+// client address, and emitting one to backends so they stop resolving the
+// client themselves. Only the v2 binary format is supported; the v1 text
+// format is deliberately out of scope.
+package proxyproto
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"fmt"
+	"net"
+)
+
+// v2Signature is the fixed 12-byte preamble of every PROXY v2 header.
+var v2Signature = []byte{0x0D, 0x0A, 0x0D, 0x0A, 0x00, 0x0D, 0x0A, 0x51, 0x55, 0x49, 0x54, 0x0A}
+
+// V2HeaderLen is the fixed part of a v2 header: signature, version/command,
+// family/transport, and the big-endian length of the address block.
+const V2HeaderLen = 16
+
+const (
+	v2VersionCommandLocal = 0x20 // health checks etc.; keep the socket address
+	v2VersionCommandProxy = 0x21
+
+	v2FamilyTCP4 = 0x11
+	v2FamilyTCP6 = 0x21
+
+	v2AddrLenTCP4 = 12 // 4+4 byte IPs, 2+2 byte ports
+	v2AddrLenTCP6 = 36 // 16+16 byte IPs, 2+2 byte ports
+)
+
+// IsV2 reports whether head starts with the PROXY v2 signature. head may be
+// shorter than the signature (e.g. a tiny cleartext payload), in which case
+// it is not a PROXY header.
+func IsV2(head []byte) bool {
+	return len(head) >= len(v2Signature) && bytes.Equal(head[:len(v2Signature)], v2Signature)
+}
+
+// Parse consumes a PROXY v2 header from r and returns the advertised client
+// address. Only the fixed header and the address block are peeked — at most
+// 52 bytes, always within the reader's buffer — while any TLV bytes behind
+// the address block are skipped with Discard, which reads through the
+// underlying connection when they exceed the peek window. Spec-valid
+// headers are therefore accepted regardless of how much vendor TLV data
+// they carry. A nil address with nil error means the header carried no
+// usable client address (LOCAL command or an address family we do not
+// transport); the caller keeps the socket peer address.
+//
+// Parse must only be called after IsV2 confirmed the signature.
+func Parse(r *bufio.Reader) (*net.TCPAddr, error) {
+	head, err := r.Peek(V2HeaderLen)
+	if err != nil {
+		return nil, fmt.Errorf("short PROXY v2 header: %w", err)
+	}
+
+	versionCommand := head[12]
+	family := head[13]
+	addrLen := int(binary.BigEndian.Uint16(head[14:16]))
+
+	var addr *net.TCPAddr
+	switch versionCommand {
+	case v2VersionCommandLocal:
+		// Connection made by the proxy itself (health check); no client.
+	case v2VersionCommandProxy:
+		// Peek only as much of the address block as the family defines,
+		// never the TLVs behind it: addrLen may legitimately exceed the
+		// peek window, the addresses themselves cannot.
+		need := 0
+		switch family {
+		case v2FamilyTCP4:
+			need = v2AddrLenTCP4
+		case v2FamilyTCP6:
+			need = v2AddrLenTCP6
+		default:
+			// UNSPEC or UDP families: consume the header, keep socket addr.
+		}
+		if need > 0 {
+			if addrLen < need {
+				return nil, fmt.Errorf("PROXY v2 address block too short for family 0x%02x: %d", family, addrLen)
+			}
+			full, err := r.Peek(V2HeaderLen + need)
+			if err != nil {
+				return nil, fmt.Errorf("short PROXY v2 address block (%d bytes): %w", addrLen, err)
+			}
+			block := full[V2HeaderLen:]
+			switch family {
+			case v2FamilyTCP4:
+				addr = &net.TCPAddr{
+					IP:   net.IP(append([]byte(nil), block[0:4]...)),
+					Port: int(binary.BigEndian.Uint16(block[8:10])),
+				}
+			case v2FamilyTCP6:
+				addr = &net.TCPAddr{
+					IP:   net.IP(append([]byte(nil), block[0:16]...)),
+					Port: int(binary.BigEndian.Uint16(block[32:34])),
+				}
+			}
+		}
+	default:
+		return nil, fmt.Errorf("unsupported PROXY version/command: 0x%02x", versionCommand)
+	}
+
+	// Discard reads through the underlying connection once the buffered
+	// bytes run out, so TLV runs larger than the buffer are consumed too.
+	if _, err := r.Discard(V2HeaderLen + addrLen); err != nil {
+		return nil, fmt.Errorf("truncated PROXY v2 header (%d bytes): %w", V2HeaderLen+addrLen, err)
+	}
+	return addr, nil
+}
+
+// AppendV2 appends a PROXY v2 PROXY-command header describing the client
+// connection (src = real client, dst = address the client connected to) and
+// returns the extended buffer, so callers can build the header in a
+// stack-allocated or pooled buffer.
+func AppendV2(buf []byte, src, dst *net.TCPAddr) []byte {
+	srcIP4, dstIP4 := src.IP.To4(), dst.IP.To4()
+
+	buf = append(buf, v2Signature...)
+	buf = append(buf, v2VersionCommandProxy)
+	if srcIP4 != nil && dstIP4 != nil {
+		buf = append(buf, v2FamilyTCP4)
+		buf = binary.BigEndian.AppendUint16(buf, v2AddrLenTCP4)
+		buf = append(buf, srcIP4...)
+		buf = append(buf, dstIP4...)
+	} else {
+		buf = append(buf, v2FamilyTCP6)
+		buf = binary.BigEndian.AppendUint16(buf, v2AddrLenTCP6)
+		buf = append(buf, src.IP.To16()...)
+		buf = append(buf, dst.IP.To16()...)
+	}
+	buf = binary.BigEndian.AppendUint16(buf, uint16(src.Port))
+	buf = binary.BigEndian.AppendUint16(buf, uint16(dst.Port))
+	return buf
+}
@@ -1,6 +1,7 @@
 package security
 
 import (
+	"bufio"
 	"errors"
 	"fmt"
 	"io"
@@ -8,30 +9,58 @@ import (
 	"net/http"
 	"os"
 	"path/filepath"
-	"regexp"
 	"strings"
 	"sync"
+	"sync/atomic"
 	"time"
 
 	"github.com/SkynetNext/unified-access-gateway/internal/config"
 	"github.com/SkynetNext/unified-access-gateway/internal/middleware"
 	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
-	"golang.org/x/time/rate"
 )
 
+// hotState bundles every piece of derived security state the request path
+// reads: the copy-on-write blocklist, sharded limiter, compiled WAF engine,
+// and allowed-subject set. It is immutable once published; updaters build a
+// fresh snapshot off-path and swap the pointer, so a request pays exactly
+// one atomic load for all of its checks.
+type hotState struct {
+	blockedIPs      map[string]struct{}
+	limiter         *shardedLimiter
+	waf             *wafEngine
+	allowedSubjects map[string]struct{}
+}
+
+// isBlockedIP reports whether ip is on the snapshot's blocklist.
+func (hs *hotState) isBlockedIP(ip string) bool {
+	if ip == "" {
+		return false
+	}
+	_, blocked := hs.blockedIPs[ip]
+	return blocked
+}
+
 // Manager coordinates auth, rate limiting, WAF, and audit logging.
 type Manager struct {
 	cfg *config.Config
 
-	stateMu         sync.RWMutex
-	allowedSubjects map[string]struct{}
-	blockedIPs      map[string]struct{}
-	blockedPatterns []*regexp.Regexp
-	limiter         *rate.Limiter
+	// stateMu serializes snapshot writers and guards the cfg mirror; the
+	// request path never takes it.
+	stateMu sync.Mutex
+
+	// hot is the single published security snapshot; see hotState.
+	hot atomic.Pointer[hotState]
 
-	auditEnabled bool
-	auditSink    io.Writer
-	auditMu      sync.Mutex
+	// Audit entries are handed to a dedicated writer goroutine through a
+	// buffered channel so the request path never blocks on sink I/O. When
+	// the queue is full, entries are dropped and counted rather than
+	// stalling traffic. Allowed requests can additionally be sampled.
+	auditEnabled     bool
+	auditSink        io.Writer
+	auditCh          chan string
+	auditSampleEvery uint64
+	auditSeq         atomic.Uint64
+	auditDrops       atomic.Uint64
 
 	redisStore *config.RedisStore
 }
@@ -41,6 +70,7 @@ func NewManager(cfg *config.Config, store *config.RedisStore) *Manager {
 		cfg:        cfg,
 		redisStore: store,
 	}
+	m.hot.Store(&hotState{})
 
 	m.loadStaticConfig()
 
@@ -81,11 +111,56 @@ func NewManager(cfg *config.Config, store *config.RedisStore) *Manager {
 		default:
 			m.auditSink = os.Stdout
 		}
+
+		// 1-in-N sampling for allow entries; denies always pass. N is
+		// derived from the configured rate (1.0 keeps everything).
+		m.auditSampleEvery = 1
+		if rate := cfg.Security.Audit.SampleRate; rate > 0 && rate < 1 {
+			m.auditSampleEvery = uint64(1 / rate)
+		}
+
+		m.auditCh = make(chan string, auditQueueSize)
+		go m.auditWriter()
 	}
 
 	return m
 }
 
+// auditQueueSize bounds the audit handoff queue. Full queue means the sink
+// cannot keep up; entries are dropped (and counted) instead of blocking the
+// request path.
+const auditQueueSize = 4096
+
+// auditWriter is the single consumer of auditCh. It opportunistically
+// coalesces everything already queued into one buffered write before
+// flushing, so sustained load amortizes sink syscalls across many entries.
+func (m *Manager) auditWriter() {
+	w := bufio.NewWriter(m.auditSink)
+	for entry := range m.auditCh {
+		w.WriteString(entry)
+	drain:
+		for {
+			select {
+			case next := <-m.auditCh:
+				w.WriteString(next)
+			default:
+				break drain
+			}
+		}
+		if err := w.Flush(); err != nil {
+			xlog.Warnf("Failed to write audit log: %v", err)
+		}
+	}
+}
+
+// sampleAllow reports whether this allowed request should be audited.
+func (m *Manager) sampleAllow() bool {
+	if m.auditSampleEvery <= 1 {
+		return true
+	}
+	return m.auditSeq.Add(1)%m.auditSampleEvery == 0
+}
+
 func (m *Manager) loadStaticConfig() {
 	if m.cfg.Security.Auth.Enabled {
 		m.UpdateAllowedSubjects(m.cfg.Security.Auth.AllowedSubjects)
@@ -144,15 +219,15 @@ func (m *Manager) CheckConnection(addr net.Addr) error {
 	if addr == nil {
 		return nil
 	}
+	hs := m.hot.Load()
 	ip := extractIP(addr.String())
 
-	if m.cfg.Security.WAF.Enabled && m.isBlockedIP(ip) {
+	if m.cfg.Security.WAF.Enabled && hs.isBlockedIP(ip) {
 		middleware.RecordSecurityBlock("waf_blocked_ip")
 		return fmt.Errorf("blocked IP: %s", ip)
 	}
 
-	limiter := m.getLimiter()
-	if limiter != nil && !limiter.Allow() {
+	if hs.limiter != nil && !hs.limiter.Allow() {
 		middleware.RecordSecurityBlock("rate_limit")
 		return errors.New("rate limit exceeded")
 	}
@@ -178,9 +253,7 @@ func (m *Manager) AuthorizeHTTP(r *http.Request) error {
 		return errors.New("client certificate subject missing")
 	}
 
-	m.stateMu.RLock()
-	allowed := m.allowedSubjects
-	m.stateMu.RUnlock()
+	allowed := m.hot.Load().allowedSubjects
 	if len(allowed) == 0 {
 		return nil
 	}
@@ -196,44 +269,34 @@ func (m *Manager) ApplyWAF(r *http.Request) error {
 	if !m.cfg.Security.WAF.Enabled {
 		return nil
 	}
+	hs := m.hot.Load()
 	ip := extractIP(r.RemoteAddr)
-	if m.isBlockedIP(ip) {
+	if hs.isBlockedIP(ip) {
 		middleware.RecordSecurityBlock("waf_blocked_ip")
 		return fmt.Errorf("blocked IP: %s", ip)
 	}
-	patterns := m.getBlockedPatterns()
-	if len(patterns) == 0 {
+	engine := hs.waf
+	if engine == nil {
 		return nil
 	}
 	payload := r.URL.Path
 	if r.URL.RawQuery != "" {
 		payload += "?" + r.URL.RawQuery
 	}
-	for _, re := range patterns {
-		if re.MatchString(payload) {
-			middleware.RecordSecurityBlock("waf_pattern_match")
-			return fmt.Errorf("blocked by pattern %s", re.String())
-		}
+	if re := engine.Match(payload); re != nil {
+		middleware.RecordSecurityBlock("waf_pattern_match")
+		return fmt.Errorf("blocked by pattern %s", re.String())
 	}
 	return nil
 }
 
-func (m *Manager) getLimiter() *rate.Limiter {
-	m.stateMu.RLock()
-	defer m.stateMu.RUnlock()
-	return m.limiter
-}
-
-func (m *Manager) getBlockedPatterns() []*regexp.Regexp {
-	m.stateMu.RLock()
-	defer m.stateMu.RUnlock()
-	return append([]*regexp.Regexp(nil), m.blockedPatterns...)
-}
-
 func (m *Manager) AuditHTTP(r *http.Request, status int, duration time.Duration, err error) {
 	if !m.auditEnabled || m.auditSink == nil {
 		return
 	}
+	if err == nil && !m.sampleAllow() {
+		return
+	}
 	action := "allow"
 	detail := ""
 	if err != nil {
@@ -258,6 +321,9 @@ func (m *Manager) AuditTCP(remoteAddr, backend string, allowed bool, detail stri
 	if !m.auditEnabled || m.auditSink == nil {
 		return
 	}
+	if allowed && !m.sampleAllow() {
+		return
+	}
 	action := "allow"
 	if !allowed {
 		action = "deny"
@@ -274,21 +340,14 @@ func (m *Manager) AuditTCP(remoteAddr, backend string, allowed bool, detail stri
 }
 
 func (m *Manager) writeAudit(payload string) {
-	m.auditMu.Lock()
-	defer m.auditMu.Unlock()
-	if _, err := m.auditSink.Write([]byte(payload)); err != nil {
-		xlog.Warnf("Failed to write audit log: %v", err)
-	}
-}
-
-func (m *Manager) isBlockedIP(ip string) bool {
-	if ip == "" {
-		return false
+	select {
+	case m.auditCh <- payload:
+	default:
+		middleware.RecordAuditDrop()
+		if m.auditDrops.Add(1)%1000 == 1 {
+			xlog.Warnf("Audit queue full, dropping entries (dropped so far: %d)", m.auditDrops.Load())
+		}
 	}
-	m.stateMu.RLock()
-	_, blocked := m.blockedIPs[ip]
-	m.stateMu.RUnlock()
-	return blocked
 }
 
 func extractIP(addr string) string {
@@ -306,78 +365,89 @@ func escapeQuotes(s string) string {
 	return strings.ReplaceAll(s, `"`, `'`)
 }
 
+// publishHot rebuilds the security snapshot with mutate applied and swaps it
+// in. The clone-and-swap runs under stateMu so concurrent updaters cannot
+// lose each other's fields, but all the expensive work (compiling patterns,
+// building sets) happens in the caller before the pointer store; readers are
+// never exposed to a partially built snapshot.
+func (m *Manager) publishHot(mutate func(next *hotState)) {
+	m.stateMu.Lock()
+	defer m.stateMu.Unlock()
+	next := *m.hot.Load()
+	mutate(&next)
+	m.hot.Store(&next)
+}
+
 // UpdateRateLimit updates rate limiter configuration at runtime
 func (m *Manager) UpdateRateLimit(rps float64, burst int) {
 	if rps <= 0 || burst <= 0 {
 		m.DisableRateLimit()
 		return
 	}
-	m.stateMu.Lock()
-	m.cfg.Security.RateLimit.Enabled = true
-	m.cfg.Security.RateLimit.RequestsPerSecond = rps
-	m.cfg.Security.RateLimit.Burst = burst
-	m.limiter = rate.NewLimiter(rate.Limit(rps), burst)
-	m.stateMu.Unlock()
+	limiter := newShardedLimiter(rps, burst)
+	m.publishHot(func(next *hotState) {
+		next.limiter = limiter
+		m.cfg.Security.RateLimit.Enabled = true
+		m.cfg.Security.RateLimit.RequestsPerSecond = rps
+		m.cfg.Security.RateLimit.Burst = burst
+	})
 	xlog.Infof("Rate limiter updated: rps=%.2f, burst=%d", rps, burst)
 }
 
 // DisableRateLimit disables rate limiting
 func (m *Manager) DisableRateLimit() {
-	m.stateMu.Lock()
-	m.cfg.Security.RateLimit.Enabled = false
-	m.cfg.Security.RateLimit.RequestsPerSecond = 0
-	m.cfg.Security.RateLimit.Burst = 0
-	m.limiter = nil
-	m.stateMu.Unlock()
+	m.publishHot(func(next *hotState) {
+		next.limiter = nil
+		m.cfg.Security.RateLimit.Enabled = false
+		m.cfg.Security.RateLimit.RequestsPerSecond = 0
+		m.cfg.Security.RateLimit.Burst = 0
+	})
 	xlog.Infof("Rate limiting disabled")
 }
 
 // UpdateBlockedIPs updates the blocked IP list at runtime
 func (m *Manager) UpdateBlockedIPs(ips []string) {
-	m.stateMu.Lock()
-	m.blockedIPs = make(map[string]struct{}, len(ips))
+	set := make(map[string]struct{}, len(ips))
 	for _, ip := range ips {
 		if ip == "" {
 			continue
 		}
-		m.blockedIPs[ip] = struct{}{}
+		set[ip] = struct{}{}
 	}
-	m.cfg.Security.WAF.BlockedIPs = append([]string(nil), ips...)
-	m.stateMu.Unlock()
+	m.publishHot(func(next *hotState) {
+		next.blockedIPs = set
+		m.cfg.Security.WAF.BlockedIPs = append([]string(nil), ips...)
+	})
 	xlog.Infof("Blocked IPs updated: count=%d", len(ips))
 }
 
-// UpdateBlockedPatterns updates the blocked pattern list at runtime
+// UpdateBlockedPatterns recompiles the WAF engine at runtime
 func (m *Manager) UpdateBlockedPatterns(patterns []string) {
-	m.stateMu.Lock()
-	m.blockedPatterns = make([]*regexp.Regexp, 0, len(patterns))
-	for _, pattern := range patterns {
-		if pattern == "" {
-			continue
-		}
-		re, err := regexp.Compile(pattern)
-		if err != nil {
-			xlog.Warnf("Invalid WAF pattern %q: %v", pattern, err)
-			continue
-		}
-		m.blockedPatterns = append(m.blockedPatterns, re)
+	engine := newWAFEngine(patterns)
+	m.publishHot(func(next *hotState) {
+		next.waf = engine
+		m.cfg.Security.WAF.BlockedPatterns = append([]string(nil), patterns...)
+	})
+
+	count := 0
+	if engine != nil {
+		count = engine.Size()
 	}
-	m.cfg.Security.WAF.BlockedPatterns = append([]string(nil), patterns...)
-	m.stateMu.Unlock()
-	xlog.Infof("Blocked patterns updated: count=%d", len(m.blockedPatterns))
+	xlog.Infof("Blocked patterns updated: count=%d", count)
 }
 
 // UpdateAllowedSubjects updates the allowed subject list at runtime
 func (m *Manager) UpdateAllowedSubjects(subjects []string) {
-	m.stateMu.Lock()
-	m.allowedSubjects = make(map[string]struct{}, len(subjects))
+	set := make(map[string]struct{}, len(subjects))
 	for _, subj := range subjects {
 		if subj == "" {
 			continue
 		}
-		m.allowedSubjects[subj] = struct{}{}
+		set[subj] = struct{}{}
 	}
-	m.cfg.Security.Auth.AllowedSubjects = append([]string(nil), subjects...)
-	m.stateMu.Unlock()
+	m.publishHot(func(next *hotState) {
+		next.allowedSubjects = set
+		m.cfg.Security.Auth.AllowedSubjects = append([]string(nil), subjects...)
+	})
 	xlog.Infof("Allowed subjects updated: count=%d", len(subjects))
 }
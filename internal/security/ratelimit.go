@@ -0,0 +1,49 @@
+package security
+
+import (
+	"runtime"
+	"sync/atomic"
+
+	"golang.org/x/time/rate"
+)
+
+// shardedLimiter splits the global rate budget across a power-of-two number
+// of token buckets so the per-connection Allow call does not serialize every
+// accept loop on a single limiter mutex. Shards are chosen round-robin with
+// one atomic add, which spreads load evenly and keeps the aggregate admitted
+// rate equal to the configured budget.
+type shardedLimiter struct {
+	shards []*rate.Limiter
+	mask   uint32
+	next   atomic.Uint32
+}
+
+// newShardedLimiter divides rps/burst across one shard per logical CPU
+// (rounded up to a power of two, capped to keep per-shard budgets sane).
+func newShardedLimiter(rps float64, burst int) *shardedLimiter {
+	count := 1
+	for count < runtime.GOMAXPROCS(0) && count < 16 {
+		count <<= 1
+	}
+
+	shardRPS := rps / float64(count)
+	shardBurst := burst / count
+	if shardBurst < 1 {
+		shardBurst = 1
+	}
+
+	s := &shardedLimiter{
+		shards: make([]*rate.Limiter, count),
+		mask:   uint32(count - 1),
+	}
+	for i := range s.shards {
+		s.shards[i] = rate.NewLimiter(rate.Limit(shardRPS), shardBurst)
+	}
+	return s
+}
+
+// Allow consumes one token from the next shard in rotation.
+func (s *shardedLimiter) Allow() bool {
+	idx := s.next.Add(1) & s.mask
+	return s.shards[idx].Allow()
+}
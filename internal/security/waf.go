@@ -0,0 +1,71 @@
+package security
+
+import (
+	"regexp"
+	"strings"
+
+	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
+)
+
+// wafEngine is an immutable compiled form of the blocked-pattern list. The
+// patterns are joined into a single alternation so the request hot path runs
+// one regexp pass regardless of how many rules are configured; only when the
+// combined expression hits do we rescan the individual patterns to attribute
+// the match for the audit log. Engines are swapped wholesale on config
+// updates and read through an atomic pointer.
+type wafEngine struct {
+	combined *regexp.Regexp
+	patterns []*regexp.Regexp
+}
+
+// newWAFEngine compiles patterns into an engine. Invalid patterns are logged
+// and skipped, matching the previous per-pattern behavior. Returns nil when
+// no pattern survives, which callers treat as "no pattern rules".
+func newWAFEngine(patterns []string) *wafEngine {
+	compiled := make([]*regexp.Regexp, 0, len(patterns))
+	exprs := make([]string, 0, len(patterns))
+	for _, pattern := range patterns {
+		if pattern == "" {
+			continue
+		}
+		re, err := regexp.Compile(pattern)
+		if err != nil {
+			xlog.Warnf("Invalid WAF pattern %q: %v", pattern, err)
+			continue
+		}
+		compiled = append(compiled, re)
+		exprs = append(exprs, "(?:"+pattern+")")
+	}
+	if len(compiled) == 0 {
+		return nil
+	}
+
+	combined, err := regexp.Compile(strings.Join(exprs, "|"))
+	if err != nil {
+		// Individually valid patterns can still clash when combined (e.g.
+		// conflicting inline flags); fall back to scanning the list.
+		xlog.Warnf("Failed to compile combined WAF expression, falling back to per-pattern scan: %v", err)
+		combined = nil
+	}
+
+	return &wafEngine{combined: combined, patterns: compiled}
+}
+
+// Match returns the pattern blocking payload, or nil if payload is clean.
+// The common case (no match) costs exactly one regexp pass.
+func (e *wafEngine) Match(payload string) *regexp.Regexp {
+	if e.combined != nil && !e.combined.MatchString(payload) {
+		return nil
+	}
+	for _, re := range e.patterns {
+		if re.MatchString(payload) {
+			return re
+		}
+	}
+	return nil
+}
+
+// Size returns the number of active patterns.
+func (e *wafEngine) Size() int {
+	return len(e.patterns)
+}
@@ -11,6 +11,8 @@
 
 // Map to store socket file descriptors (using socket cookie as key)
 // SOCKHASH allows efficient socket lookup and redirection
+// max_entries here (and on the maps below) is only a default; userspace
+// overrides it from config before the maps are created
 struct {
   __uint(type, BPF_MAP_TYPE_SOCKHASH);
   __uint(max_entries, 65535);
@@ -28,6 +30,42 @@ struct {
   __uint(value_size, sizeof(__u64));
 } sock_pair_map SEC(".maps");
 
+// Per-socket traffic counters for kernel-redirected data
+// Key: receiving socket cookie
+// Userspace attributes direction from its own pair bookkeeping and
+// removes entries when the pair is unregistered
+struct sock_stats {
+  __u64 bytes;
+  __u64 packets;
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_HASH);
+  __uint(max_entries, 65535);
+  __uint(key_size, sizeof(__u64));
+  __uint(value_size, sizeof(struct sock_stats));
+} sock_stats_map SEC(".maps");
+
+// Intended pairings written by userspace just before it dials a backend.
+// Key: the dialing socket's identifying tuple — remote ip/port plus the
+// local port bound up front (the local IP is not known until connect routes,
+// so it is left out; ephemeral ports are unique per destination within the
+// gateway). Value: the client socket cookie to pair with.
+// Consumed by the sockops program at ACTIVE_ESTABLISHED time, so the
+// redirect is live from the first backend byte with no userspace window.
+struct pair_intent_key {
+  __u32 remote_ip4;  // network byte order
+  __u16 remote_port; // network byte order
+  __u16 local_port;  // network byte order
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_HASH);
+  __uint(max_entries, 65535);
+  __uint(key_size, sizeof(struct pair_intent_key));
+  __uint(value_size, sizeof(__u64));
+} pair_intent_map SEC(".maps");
+
 // Parser program: parse incoming data length
 SEC("sk_skb/stream_parser")
 int sock_stream_parser(struct __sk_buff *skb) {
@@ -51,6 +89,17 @@ int sock_stream_verdict(struct __sk_buff *skb) {
     return SK_PASS;
   }
 
+  // Account redirected traffic; userspace io.Copy never sees these bytes,
+  // so this map is the only place they can be counted
+  struct sock_stats *stats = bpf_map_lookup_elem(&sock_stats_map, &cookie);
+  if (stats) {
+    __sync_fetch_and_add(&stats->bytes, skb->len);
+    __sync_fetch_and_add(&stats->packets, 1);
+  } else {
+    struct sock_stats init = {.bytes = skb->len, .packets = 1};
+    bpf_map_update_elem(&sock_stats_map, &cookie, &init, BPF_ANY);
+  }
+
   // Redirect to peer socket (kernel-level forwarding)
   return bpf_sk_redirect_hash(skb, &sock_map, peer_cookie, BPF_F_INGRESS);
 }
@@ -64,8 +113,10 @@ int sock_ops_handler(struct bpf_sock_ops *skops) {
   switch (op) {
   case BPF_SOCK_OPS_PASSIVE_ESTABLISHED_CB:
   case BPF_SOCK_OPS_ACTIVE_ESTABLISHED_CB:
-    // Only handle IPv4 TCP connections
-    if (skops->family != AF_INET) {
+    // Handle IPv4 and IPv6 TCP connections.
+    // V4-mapped-v6 sockets (dual-stack listeners) report AF_INET6, so this
+    // check also covers IPv4 clients hitting an IPv6 wildcard listener.
+    if (skops->family != AF_INET && skops->family != AF_INET6) {
       break;
     }
 
@@ -74,11 +125,34 @@ int sock_ops_handler(struct bpf_sock_ops *skops) {
 
     // Add socket to sockmap
     bpf_sock_hash_update(skops, &sock_map, &cookie, BPF_NOEXIST);
+
+    // Outgoing backend connections: consume a pairing intent written by
+    // userspace before the dial, so both pair directions exist the moment
+    // the handshake completes. The client socket joined sock_map via its
+    // own established callback, so redirects work immediately.
+    if (op == BPF_SOCK_OPS_ACTIVE_ESTABLISHED_CB && skops->family == AF_INET) {
+      struct pair_intent_key ikey = {
+          .remote_ip4 = skops->remote_ip4,
+          // remote_port is already network byte order; local_port is host
+          // order. Both end up as network-order 16-bit values, matching the
+          // key layout userspace writes.
+          .remote_port = (__u16)(skops->remote_port >> 16),
+          .local_port = (__u16)(bpf_htonl(skops->local_port) >> 16),
+      };
+      __u64 *client_cookie = bpf_map_lookup_elem(&pair_intent_map, &ikey);
+      if (client_cookie) {
+        __u64 peer = *client_cookie;
+        bpf_map_update_elem(&sock_pair_map, &cookie, &peer, BPF_ANY);
+        bpf_map_update_elem(&sock_pair_map, &peer, &cookie, BPF_ANY);
+        bpf_map_delete_elem(&pair_intent_map, &ikey);
+      }
+    }
     break;
 
   case BPF_SOCK_OPS_STATE_CB:
     // Socket state changed (e.g., closed)
-    if (skops->args[1] == BPF_TCP_CLOSE && skops->family == AF_INET) {
+    if (skops->args[1] == BPF_TCP_CLOSE &&
+        (skops->family == AF_INET || skops->family == AF_INET6)) {
       cookie = bpf_get_socket_cookie_ops(skops);
       // Remove from maps (cleanup)
       bpf_map_delete_elem(&sock_map, &cookie);
@@ -10,7 +10,10 @@ import (
 	"os"
 	"os/exec"
 	"strings"
+	"sync"
+	"sync/atomic"
 	"syscall"
+	"time"
 	"unsafe"
 
 	"github.com/SkynetNext/unified-access-gateway/pkg/xlog"
@@ -24,6 +27,12 @@ import (
 // SO_COOKIE socket option (Linux-specific)
 const SO_COOKIE = 57
 
+// defaultSockMapMaxEntries matches the size historically compiled into
+// sockmap.c. sock_map and sock_stats_map hold one entry per socket and
+// sock_pair_map holds two per proxied connection, so the configured value
+// should be at least 2x the expected concurrent connection count.
+const defaultSockMapMaxEntries = 65535
+
 // UnwrappableConn is an interface for connections that wrap another net.Conn
 // Implementations should return the underlying connection
 type UnwrappableConn interface {
@@ -32,12 +41,16 @@ type UnwrappableConn interface {
 }
 
 // unwrapConn extracts the underlying net.Conn from wrapped connections
-// Uses interface instead of reflection for better performance
+// Uses interface instead of reflection for better performance; loops so
+// stacked wrappers (sniff buffer over connection tracking) unwrap fully
 func unwrapConn(conn net.Conn) net.Conn {
-	if unwrappable, ok := conn.(UnwrappableConn); ok {
-		return unwrappable.Unwrap()
+	for {
+		unwrappable, ok := conn.(UnwrappableConn)
+		if !ok {
+			return conn
+		}
+		conn = unwrappable.Unwrap()
 	}
-	return conn
 }
 
 // SockMapManager manages eBPF sockmap for socket redirection
@@ -45,10 +58,39 @@ type SockMapManager struct {
 	objs       *bpfObjects
 	cgroupLink link.Link
 	enabled    bool
+
+	// Set once the kernel rejects BPF_MAP_UPDATE_BATCH so we stop retrying
+	// it and go straight to per-entry updates (kernels < 5.6).
+	batchUnsupported atomic.Bool
+
+	// Per-cookie bookkeeping for the sock_stats_map poller.
+	statsMu      sync.Mutex
+	statsCookies map[uint64]*cookieStats
+	statsSink    StatsSink
+	statsStop    chan struct{}
+}
+
+// bpfSockStats mirrors struct sock_stats in sockmap.c.
+type bpfSockStats struct {
+	Bytes   uint64
+	Packets uint64
 }
 
-// NewSockMapManager creates a new sockmap manager
-func NewSockMapManager() (*SockMapManager, error) {
+// cookieStats tracks the last totals read from sock_stats_map for one socket.
+// inbound means the cookie belongs to the client socket, i.e. the bytes the
+// kernel redirected for it flowed client->backend.
+type cookieStats struct {
+	inbound bool
+	bytes   uint64
+}
+
+// StatsSink receives byte deltas observed on the kernel fast path, split by
+// direction (client->backend = in, backend->client = out).
+type StatsSink func(bytesIn, bytesOut uint64)
+
+// NewSockMapManager creates a new sockmap manager. maxEntries sizes all
+// three BPF maps; values <= 0 keep the built-in default.
+func NewSockMapManager(maxEntries int) (*SockMapManager, error) {
 	// Allow the current process to lock memory for eBPF resources.
 	if err := rlimit.RemoveMemlock(); err != nil {
 		xlog.Warnf("Failed to remove memlock limit: %v", err)
@@ -68,15 +110,33 @@ func NewSockMapManager() (*SockMapManager, error) {
 		return &SockMapManager{enabled: false}, nil
 	}
 
-	// Load pre-compiled eBPF objects
+	if maxEntries <= 0 {
+		maxEntries = defaultSockMapMaxEntries
+	}
+
+	// Load the pre-compiled collection spec and resize the maps before they
+	// are created; the max_entries values in sockmap.c are only defaults.
+	spec, err := loadBpf()
+	if err != nil {
+		xlog.Warnf("Failed to load eBPF collection spec: %v", err)
+		xlog.Infof("Falling back to userspace proxy.")
+		return &SockMapManager{enabled: false}, nil
+	}
+	for _, name := range []string{"sock_map", "sock_pair_map", "sock_stats_map", "pair_intent_map"} {
+		if mapSpec, ok := spec.Maps[name]; ok {
+			mapSpec.MaxEntries = uint32(maxEntries)
+		}
+	}
+
+	// Load eBPF objects from the adjusted spec
 	// Try to load with BTF support
-	opts := &ebpf.CollectionOptions{
+	opts := ebpf.CollectionOptions{
 		Programs: ebpf.ProgramOptions{
 			// Kernel BTF will be used automatically if available
 		},
 	}
 	objs := &bpfObjects{}
-	if err := loadBpfObjects(objs, opts); err != nil {
+	if err := spec.LoadAndAssign(objs, &opts); err != nil {
 		// Extract detailed error information
 		errMsg := err.Error()
 
@@ -134,14 +194,28 @@ func NewSockMapManager() (*SockMapManager, error) {
 	}
 
 	mgr := &SockMapManager{
-		objs:    objs,
-		enabled: true,
+		objs:         objs,
+		enabled:      true,
+		statsCookies: make(map[uint64]*cookieStats),
 	}
 
-	xlog.Infof("eBPF SockMap loaded successfully")
+	xlog.Infof("eBPF SockMap loaded successfully (map capacity: %d entries)", maxEntries)
 	return mgr, nil
 }
 
+// Occupancy returns the number of sockets currently registered for kernel
+// redirection (sock_pair_map entries). Compared against the configured map
+// capacity this shows fast-path coverage and remaining headroom.
+func (m *SockMapManager) Occupancy() int {
+	if !m.enabled {
+		return 0
+	}
+	m.statsMu.Lock()
+	n := len(m.statsCookies)
+	m.statsMu.Unlock()
+	return n
+}
+
 // readKernelLogs reads recent kernel logs related to BPF
 func readKernelLogs() string {
 	// Try to read dmesg (requires permissions)
@@ -290,10 +364,298 @@ func (m *SockMapManager) RegisterSocketPair(clientConn, backendConn net.Conn) er
 		return fmt.Errorf("updating sock_pair_map (backend->client): %w", err)
 	}
 
+	m.trackPair(clientCookie, backendCookie)
+
 	xlog.Debugf("Registered socket pair: client=%d <-> backend=%d", clientCookie, backendCookie)
 	return nil
 }
 
+// pairIntentKey mirrors struct pair_intent_key in sockmap.c. All fields are
+// stored in network byte order, matching how the sockops program builds the
+// key from its context at established time.
+type pairIntentKey struct {
+	RemoteIP4  [4]byte
+	RemotePort [2]byte
+	LocalPort  [2]byte
+}
+
+// DialWithIntent dials a backend with a pairing intent planted for the
+// sockops program: the socket is bound to an ephemeral port up front so the
+// intent key is complete before connect, and the kernel writes both
+// sock_pair_map directions inside the established callback. The redirect is
+// therefore live from the first backend byte, with no window where traffic
+// must traverse userspace waiting on registration syscalls.
+//
+// Returns the connection and whether the kernel completed the pairing.
+// Every unsupported or failed condition (eBPF disabled, IPv6 backend,
+// sockops not attached) degrades to a plain dial with paired=false, and the
+// caller falls back to userspace registration.
+func (m *SockMapManager) DialWithIntent(clientConn net.Conn, address string, timeout time.Duration) (net.Conn, bool, error) {
+	if !m.enabled {
+		c, err := net.DialTimeout("tcp", address, timeout)
+		return c, false, err
+	}
+	clientCookie, err := getSocketCookie(clientConn)
+	if err != nil {
+		c, err := net.DialTimeout("tcp", address, timeout)
+		return c, false, err
+	}
+	raddr, err := net.ResolveTCPAddr("tcp", address)
+	if err != nil {
+		return nil, false, err
+	}
+	ip4 := raddr.IP.To4()
+	if ip4 == nil {
+		// Intent keys are IPv4-only; v6 backends keep the userspace path.
+		c, err := net.DialTimeout("tcp", address, timeout)
+		return c, false, err
+	}
+
+	var key pairIntentKey
+	copy(key.RemoteIP4[:], ip4)
+	key.RemotePort[0] = byte(raddr.Port >> 8)
+	key.RemotePort[1] = byte(raddr.Port)
+
+	var intentErr error
+	d := net.Dialer{
+		Timeout: timeout,
+		Control: func(network, addr string, rc syscall.RawConn) error {
+			return rc.Control(func(fd uintptr) {
+				// Bind explicitly so the local port — the part of the key the
+				// kernel matches at established time — exists before the
+				// handshake starts.
+				if err := syscall.Bind(int(fd), &syscall.SockaddrInet4{}); err != nil {
+					intentErr = err
+					return
+				}
+				sa, err := syscall.Getsockname(int(fd))
+				if err != nil {
+					intentErr = err
+					return
+				}
+				sa4, ok := sa.(*syscall.SockaddrInet4)
+				if !ok {
+					intentErr = errors.New("unexpected local sockaddr family")
+					return
+				}
+				key.LocalPort[0] = byte(sa4.Port >> 8)
+				key.LocalPort[1] = byte(sa4.Port)
+				intentErr = m.objs.PairIntentMap.Update(key, clientCookie, ebpf.UpdateAny)
+			})
+		},
+	}
+	// Dial the resolved address so the connected peer is exactly the one in
+	// the intent key even if the configured address was a hostname.
+	conn, err := d.Dial("tcp", raddr.String())
+	if err != nil {
+		if intentErr == nil {
+			m.objs.PairIntentMap.Delete(key)
+		}
+		return nil, false, err
+	}
+	if intentErr != nil {
+		// Socket dialed fine but the intent never reached the kernel; treat
+		// it as an ordinary dial.
+		xlog.Debugf("Pairing intent for %s not planted: %v", address, intentErr)
+		return conn, false, nil
+	}
+
+	// The established callback runs inside the handshake, so by now the
+	// intent is either consumed or never will be (e.g. sockops unattached).
+	// Verify the pairing took and clean up so unconsumed intents cannot
+	// accumulate in the map.
+	backendCookie, err := getSocketCookie(conn)
+	if err != nil {
+		m.objs.PairIntentMap.Delete(key)
+		return conn, false, nil
+	}
+	var peer uint64
+	if err := m.objs.SockPairMap.Lookup(backendCookie, &peer); err != nil || peer != clientCookie {
+		m.objs.PairIntentMap.Delete(key)
+		return conn, false, nil
+	}
+	m.trackPair(clientCookie, backendCookie)
+	xlog.Debugf("Kernel-paired socket pair: client=%d <-> backend=%d", clientCookie, backendCookie)
+	return conn, true, nil
+}
+
+// StartStatsPoller periodically drains sock_stats_map and reports byte deltas
+// to sink. Kernel-redirected traffic never reaches the userspace relay, so
+// without this the byte counters undercount exactly the hottest connections.
+func (m *SockMapManager) StartStatsPoller(interval time.Duration, sink StatsSink) {
+	if !m.enabled || sink == nil {
+		return
+	}
+
+	m.statsMu.Lock()
+	m.statsSink = sink
+	m.statsMu.Unlock()
+
+	m.statsStop = make(chan struct{})
+	go func() {
+		ticker := time.NewTicker(interval)
+		defer ticker.Stop()
+		for {
+			select {
+			case <-ticker.C:
+				m.pollStats()
+			case <-m.statsStop:
+				return
+			}
+		}
+	}()
+	xlog.Infof("eBPF sockmap stats poller started (interval: %v)", interval)
+}
+
+// pollStats reads current totals for every tracked cookie and reports the
+// delta since the previous poll, attributed by direction.
+//
+// The per-cookie map lookups are syscalls and there is one per tracked
+// socket, so they must not run under statsMu: trackPair takes the same
+// mutex on the accept path, and holding it across tens of thousands of
+// syscalls would stall every new connection's pairing for the whole poll.
+// Instead the cookie set is snapshotted under the lock, the lookups run
+// unlocked, and the lock is retaken only to fold the deltas in.
+func (m *SockMapManager) pollStats() {
+	m.statsMu.Lock()
+	cookies := make([]uint64, 0, len(m.statsCookies))
+	for cookie := range m.statsCookies {
+		cookies = append(cookies, cookie)
+	}
+	sink := m.statsSink
+	m.statsMu.Unlock()
+
+	totals := make(map[uint64]uint64, len(cookies))
+	for _, cookie := range cookies {
+		var stats bpfSockStats
+		if err := m.objs.SockStatsMap.Lookup(cookie, &stats); err != nil {
+			continue
+		}
+		totals[cookie] = stats.Bytes
+	}
+
+	var in, out uint64
+	m.statsMu.Lock()
+	for cookie, bytes := range totals {
+		cs, ok := m.statsCookies[cookie]
+		if !ok {
+			// Untracked between snapshot and now: forgetCookie already
+			// flushed this cookie's final delta, counting ours too would
+			// double-report it.
+			continue
+		}
+		delta := bytes - cs.bytes
+		cs.bytes = bytes
+		if cs.inbound {
+			in += delta
+		} else {
+			out += delta
+		}
+	}
+	m.statsMu.Unlock()
+
+	// Fire every tick, even with zero deltas, so callers can also refresh
+	// gauges (e.g. map occupancy) from the sink at a steady cadence.
+	if sink != nil {
+		sink(in, out)
+	}
+}
+
+// trackPair records cookie direction so polled byte counts can be attributed.
+func (m *SockMapManager) trackPair(clientCookie, backendCookie uint64) {
+	m.statsMu.Lock()
+	m.statsCookies[clientCookie] = &cookieStats{inbound: true}
+	m.statsCookies[backendCookie] = &cookieStats{}
+	m.statsMu.Unlock()
+}
+
+// forgetCookie flushes the final counter delta for a cookie, stops tracking
+// it, and removes its sock_stats_map entry.
+func (m *SockMapManager) forgetCookie(cookie uint64) {
+	var in, out uint64
+
+	m.statsMu.Lock()
+	if cs, ok := m.statsCookies[cookie]; ok {
+		var stats bpfSockStats
+		if err := m.objs.SockStatsMap.Lookup(cookie, &stats); err == nil {
+			delta := stats.Bytes - cs.bytes
+			if cs.inbound {
+				in = delta
+			} else {
+				out = delta
+			}
+		}
+		delete(m.statsCookies, cookie)
+	}
+	sink := m.statsSink
+	m.statsMu.Unlock()
+
+	m.objs.SockStatsMap.Delete(cookie)
+	if sink != nil && (in > 0 || out > 0) {
+		sink(in, out)
+	}
+}
+
+// SocketPair couples an accepted client connection with its dialed backend
+// connection for batched registration in sock_pair_map.
+type SocketPair struct {
+	Client  net.Conn
+	Backend net.Conn
+}
+
+// RegisterSocketPairs registers a batch of client-backend pairs, using a
+// single BPF_MAP_UPDATE_BATCH syscall where the kernel supports it. Cookie
+// extraction is also done here, off the accept path, so connection setup
+// pays amortized one syscall instead of four (two getsockopt + two updates).
+// Pairs whose sockets have already closed are skipped.
+func (m *SockMapManager) RegisterSocketPairs(pairs []SocketPair) error {
+	if !m.enabled || len(pairs) == 0 {
+		return nil
+	}
+
+	// Each pair contributes two entries: client->backend and backend->client.
+	keys := make([]uint64, 0, len(pairs)*2)
+	values := make([]uint64, 0, len(pairs)*2)
+	for _, p := range pairs {
+		clientCookie, err := getSocketCookie(p.Client)
+		if err != nil {
+			xlog.Debugf("Skipping pair in batch (client cookie): %v", err)
+			continue
+		}
+		backendCookie, err := getSocketCookie(p.Backend)
+		if err != nil {
+			xlog.Debugf("Skipping pair in batch (backend cookie): %v", err)
+			continue
+		}
+		keys = append(keys, clientCookie, backendCookie)
+		values = append(values, backendCookie, clientCookie)
+		m.trackPair(clientCookie, backendCookie)
+	}
+	if len(keys) == 0 {
+		return nil
+	}
+
+	if !m.batchUnsupported.Load() {
+		if _, err := m.objs.SockPairMap.BatchUpdate(keys, values, nil); err == nil {
+			xlog.Debugf("Registered %d socket pairs via batch update", len(keys)/2)
+			return nil
+		} else if errors.Is(err, ebpf.ErrNotSupported) {
+			m.batchUnsupported.Store(true)
+			xlog.Infof("Kernel lacks BPF_MAP_UPDATE_BATCH, falling back to per-entry sock_pair_map updates")
+		} else {
+			return fmt.Errorf("batch updating sock_pair_map: %w", err)
+		}
+	}
+
+	// Per-entry fallback for kernels without batch map operations.
+	for i := range keys {
+		if err := m.objs.SockPairMap.Update(keys[i], values[i], ebpf.UpdateAny); err != nil {
+			return fmt.Errorf("updating sock_pair_map: %w", err)
+		}
+	}
+	return nil
+}
+
 // UnregisterSocketPair removes a socket pair from the map
 func (m *SockMapManager) UnregisterSocketPair(clientConn, backendConn net.Conn) error {
 	if !m.enabled {
@@ -306,6 +668,10 @@ func (m *SockMapManager) UnregisterSocketPair(clientConn, backendConn net.Conn)
 	m.objs.SockPairMap.Delete(&clientCookie)
 	m.objs.SockPairMap.Delete(&backendCookie)
 
+	// Flush the last fast-path byte counts before dropping the entries.
+	m.forgetCookie(clientCookie)
+	m.forgetCookie(backendCookie)
+
 	return nil
 }
 
@@ -315,6 +681,10 @@ func (m *SockMapManager) Close() error {
 		return nil
 	}
 
+	if m.statsStop != nil {
+		close(m.statsStop)
+	}
+
 	if m.cgroupLink != nil {
 		m.cgroupLink.Close()
 	}
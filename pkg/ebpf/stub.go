@@ -6,6 +6,7 @@ package ebpf
 import (
 	"errors"
 	"net"
+	"time"
 )
 
 // Stub implementation for non-Linux platforms
@@ -27,10 +28,15 @@ type SockMapManager struct {
 }
 
 // NewSockMapManager returns a disabled manager on non-Linux platforms
-func NewSockMapManager() (*SockMapManager, error) {
+func NewSockMapManager(maxEntries int) (*SockMapManager, error) {
 	return &SockMapManager{enabled: false}, nil
 }
 
+// Occupancy always returns 0 on non-Linux platforms
+func (m *SockMapManager) Occupancy() int {
+	return 0
+}
+
 // AttachToCgroup is a no-op on non-Linux platforms
 func (m *SockMapManager) AttachToCgroup(cgroupPath string) error {
 	return errors.New("eBPF not supported on this platform")
@@ -41,6 +47,30 @@ func (m *SockMapManager) RegisterSocketPair(clientConn, backendConn net.Conn) er
 	return nil // Silently skip
 }
 
+// SocketPair mirrors the Linux implementation's batch registration input
+type SocketPair struct {
+	Client  net.Conn
+	Backend net.Conn
+}
+
+// RegisterSocketPairs is a no-op on non-Linux platforms
+func (m *SockMapManager) RegisterSocketPairs(pairs []SocketPair) error {
+	return nil
+}
+
+// DialWithIntent degrades to a plain dial on non-Linux platforms
+func (m *SockMapManager) DialWithIntent(clientConn net.Conn, address string, timeout time.Duration) (net.Conn, bool, error) {
+	c, err := net.DialTimeout("tcp", address, timeout)
+	return c, false, err
+}
+
+// StatsSink mirrors the Linux implementation's stats callback
+type StatsSink func(bytesIn, bytesOut uint64)
+
+// StartStatsPoller is a no-op on non-Linux platforms
+func (m *SockMapManager) StartStatsPoller(interval time.Duration, sink StatsSink) {
+}
+
 // UnregisterSocketPair is a no-op on non-Linux platforms
 func (m *SockMapManager) UnregisterSocketPair(clientConn, backendConn net.Conn) error {
 	return nil
@@ -55,4 +85,3 @@ func (m *SockMapManager) Close() error {
 func (m *SockMapManager) IsEnabled() bool {
 	return false
 }
-